@@ -3,6 +3,12 @@
 #include "../src/RenderAsset.h"
 #include "../src/IRenderAsset.h"
 #include "../src/ResourceRepository.h"
+#include "../src/ResourceQuery.h"
+#include "../src/ThreadPool.h"
+#include "../src/VertexCodec.h"
+#include "../src/ResourceCache.h"
+#include "../src/PersistentResourceCache.h"
+#include "../src/RepositoryDiff.h"
 #include "../src/PrimRenderPrimitiveBuilder.h"
 #include "../src/RPKG.h"
 #include "../src/PRIM.h"
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace GlacierFormats {
+
+	//Non-owning view of a contiguous, read-only array. Valid as long as the viewed memory is.
+	template<typename T>
+	class ArrayView {
+	private:
+		const T* data_;
+		size_t size_;
+
+	public:
+		using value_type = T;
+
+		ArrayView() noexcept : data_(nullptr), size_(0) {
+		}
+
+		ArrayView(const T* data, size_t size) noexcept : data_(data), size_(size) {
+		}
+
+		ArrayView(const std::vector<T>& vec) noexcept : data_(vec.data()), size_(vec.size()) {
+		}
+
+		[[nodiscard]] const T* data() const noexcept {
+			return data_;
+		}
+
+		[[nodiscard]] size_t size() const noexcept {
+			return size_;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return size_ == 0;
+		}
+
+		[[nodiscard]] const T* begin() const noexcept {
+			return data_;
+		}
+
+		[[nodiscard]] const T* end() const noexcept {
+			return data_ + size_;
+		}
+
+		[[nodiscard]] const T& operator[](size_t idx) const noexcept {
+			return data_[idx];
+		}
+	};
+
+	//Non-owning view of count elements that consist of components consecutive values each. Consecutive elements are
+	//stride values apart, e.g. the xyz components of an array of float4. Valid as long as the viewed memory is.
+	template<typename T>
+	class StridedArrayView {
+	private:
+		const T* data_;
+		size_t size_;
+		size_t components_;
+		size_t stride_;
+
+	public:
+		using value_type = T;
+
+		StridedArrayView() noexcept : data_(nullptr), size_(0), components_(1), stride_(1) {
+		}
+
+		StridedArrayView(const T* data, size_t size, size_t components, size_t stride) noexcept : 
+			data_(data), size_(size), components_(components), stride_(stride) {
+		}
+
+		//Tightly packed view of view.size() / components elements.
+		StridedArrayView(ArrayView<T> view, size_t components) noexcept : 
+			data_(view.data()), size_(view.size() / components), components_(components), stride_(components) {
+		}
+
+		[[nodiscard]] const T* data() const noexcept {
+			return data_;
+		}
+
+		//Element count.
+		[[nodiscard]] size_t size() const noexcept {
+			return size_;
+		}
+
+		[[nodiscard]] size_t components() const noexcept {
+			return components_;
+		}
+
+		[[nodiscard]] size_t stride() const noexcept {
+			return stride_;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return size_ == 0;
+		}
+
+		[[nodiscard]] bool isContiguous() const noexcept {
+			return stride_ == components_;
+		}
+
+		//Returns a pointer to the components of element idx.
+		[[nodiscard]] const T* operator[](size_t idx) const noexcept {
+			return data_ + idx * stride_;
+		}
+
+		//Returns the viewed values tightly packed. Contiguous views are returned as is, others are copied into scratch. scratch
+		//must not be the viewed memory.
+		[[nodiscard]] ArrayView<T> contiguous(std::vector<T>& scratch) const {
+			if (isContiguous())
+				return ArrayView<T>(data_, size_ * components_);
+
+			scratch.resize(size_ * components_);
+			for (size_t i = 0; i < size_; ++i)
+				std::copy_n((*this)[i], components_, &scratch[i * components_]);
+			return ArrayView<T>(scratch);
+		}
+	};
+
+}
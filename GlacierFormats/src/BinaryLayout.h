@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace GlacierFormats {
+
+	namespace detail {
+
+		template<typename T>
+		struct MemberPointerTraits;
+
+		template<typename C, typename M>
+		struct MemberPointerTraits<M C::*> {
+			using Class = C;
+			using Member = M;
+		};
+
+		template<typename T, typename = void>
+		struct HasAssert : std::false_type {};
+
+		template<typename T>
+		struct HasAssert<T, std::void_t<decltype(std::declval<T&>().Assert())>> : std::true_type {};
+
+	}
+
+	//Field of a binary layout that is serialized as the raw bytes of a data member.
+	template<auto member_pointer>
+	struct Field {
+		using Class = typename detail::MemberPointerTraits<decltype(member_pointer)>::Class;
+		using Type = typename detail::MemberPointerTraits<decltype(member_pointer)>::Member;
+		static_assert(std::is_trivially_copyable_v<Type>, "Raw fields must be trivially copyable, use EncodedField instead.");
+
+		static constexpr size_t size = sizeof(Type);
+		static constexpr bool is_raw = true;
+		static constexpr auto member = member_pointer;
+
+		static void load(Class& obj, const char* src) noexcept {
+			std::memcpy(&(obj.*member), src, size);
+		}
+
+		static void store(const Class& obj, char* dst) noexcept {
+			std::memcpy(dst, &(obj.*member), size);
+		}
+	};
+
+	//Field of a binary layout with a custom encoding. Encoding has to provide a trivially copyable Packed type and
+	//static void decode(Class&, const Packed&) and static Packed encode(const Class&) functions.
+	template<typename C, typename Encoding>
+	struct EncodedField {
+		using Class = C;
+		using Type = typename Encoding::Packed;
+		static_assert(std::is_trivially_copyable_v<Type>);
+
+		static constexpr size_t size = sizeof(Type);
+		static constexpr bool is_raw = false;
+
+		static void load(Class& obj, const char* src) {
+			Type packed;
+			std::memcpy(&packed, src, size);
+			Encoding::decode(obj, packed);
+		}
+
+		static void store(const Class& obj, char* dst) {
+			const Type packed = Encoding::encode(obj);
+			std::memcpy(dst, &packed, size);
+		}
+	};
+
+	//Declarative description of the serialized layout of T. Fields are serialized back to back in declaration order.
+	//Reads and writes go through a single stack buffer, so a layout costs one bounds checked reader/writer call
+	//regardless of its field count. Layouts of trivially copyable structs without padding that list all members
+	//in order are read and written as a whole, see is_memory_layout. If T has an Assert() member like the structs in
+	//PrimSerializationTypes.h, read calls it on every decoded object.
+	template<typename T, typename... Fields>
+	struct BinaryLayout {
+		static_assert(sizeof...(Fields) > 0);
+		static_assert((std::is_same_v<T, typename Fields::Class> && ...), "Layout fields must be members of T.");
+
+		//Serialized size in bytes.
+		static constexpr size_t size = (Fields::size + ...);
+
+		//True if the serialized layout can be identical to the in-memory layout of T. Field order can't be checked at 
+		//compile time, objects are only copied as a whole if usesMemoryLayout also verified it at runtime.
+		static constexpr bool is_memory_layout = std::is_trivially_copyable_v<T> && sizeof(T) == size && (Fields::is_raw && ...);
+
+		//True if objects are copied as a whole. Evaluated once, layouts that list their fields out of member order fall
+		//back to field wise copies.
+		static bool usesMemoryLayout() {
+			if constexpr (is_memory_layout) {
+				static const bool uses_memory_layout = matchesMemoryLayout();
+				return uses_memory_layout;
+			}
+			else {
+				return false;
+			}
+		}
+
+		//Decodes an object from size bytes at src.
+		static void load(T& obj, const char* src) {
+			if constexpr (is_memory_layout) {
+				if (usesMemoryLayout()) {
+					std::memcpy(&obj, src, size);
+					return;
+				}
+			}
+			size_t offset = 0;
+			((Fields::load(obj, src + offset), offset += Fields::size), ...);
+		}
+
+		//Encodes obj into size bytes at dst.
+		static void store(const T& obj, char* dst) {
+			if constexpr (is_memory_layout) {
+				if (usesMemoryLayout()) {
+					std::memcpy(dst, &obj, size);
+					return;
+				}
+			}
+			size_t offset = 0;
+			((Fields::store(obj, dst + offset), offset += Fields::size), ...);
+		}
+
+		template<typename Reader>
+		static T read(Reader& br) {
+			T obj{};
+			read(br, obj);
+			return obj;
+		}
+
+		template<typename Reader>
+		static void read(Reader& br, T& obj) {
+			if constexpr (is_memory_layout) {
+				if (usesMemoryLayout())
+					obj = br.template read<T>();
+				else
+					readFields(br, obj);
+			}
+			else {
+				readFields(br, obj);
+			}
+
+			if constexpr (detail::HasAssert<T>::value)
+				obj.Assert();
+		}
+
+		template<typename Writer>
+		static void write(Writer& bw, const T& obj) {
+			if constexpr (is_memory_layout) {
+				if (usesMemoryLayout()) {
+					bw.write(obj);
+					return;
+				}
+			}
+			char buf[size];
+			store(obj, buf);
+			bw.write(buf, size);
+		}
+
+	private:
+		template<typename Reader>
+		static void readFields(Reader& br, T& obj) {
+			char buf[size];
+			br.read(buf, size);
+			load(obj, buf);
+		}
+
+	public:
+		//Checks that the fields are listed in member order, i.e. that each field is stored at the offset the layout
+		//serializes it at. Always false for layouts with encoded fields.
+		static bool matchesMemoryLayout() {
+			if constexpr (!(Fields::is_raw && ...)) {
+				return false;
+			}
+			else {
+				const T probe{};
+				const auto* base = reinterpret_cast<const char*>(&probe);
+				size_t offset = 0;
+				bool match = sizeof(T) == size;
+				((match = match && reinterpret_cast<const char*>(&(probe.*Fields::member)) - base == static_cast<ptrdiff_t>(offset), offset += Fields::size), ...);
+				return match;
+			}
+		}
+	};
+
+}
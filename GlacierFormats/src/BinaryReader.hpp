@@ -1,5 +1,7 @@
 #pragma once
 #include "Exceptions.h"
+#include "ArrayView.h"
+#include "ReadCoverage.h"
 #include <memory>
 #include <fstream>
 #include <filesystem>
@@ -8,6 +10,10 @@
 #include <algorithm>
 #include <memory>
 #include <numeric>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+#include <string_view>
 
 
 namespace GlacierFormats {
@@ -20,6 +26,12 @@ namespace GlacierFormats {
 		virtual int64_t tell() = 0; //can't be const because ifstream equivalent isn't const.
 		virtual int64_t size() const = 0;
 
+		//Returns a pointer to the next len bytes and advances the read position if the source is backed by contiguous memory.
+		//Returns nullptr without advancing otherwise, callers then have to fall back to read.
+		virtual const char* view(int64_t len) {
+			return nullptr;
+		}
+
 		virtual ~IBinaryReaderSource() {};
 	};
 
@@ -96,6 +108,14 @@ namespace GlacierFormats {
 			memcpy_s(dst, len, &(read_buffer[cur]), len);
 		}
 
+		const char* view(int64_t len) override {
+			if (cur + len > buffer_size)
+				throw InvalidArgumentsException("Out of bounds read");
+			const char* ptr = &read_buffer[cur];
+			cur += len;
+			return ptr;
+		}
+
 		void seek(int64_t offset) override final {
 			if(offset > buffer_size)
 				throw InvalidArgumentsException("Out of bounds seek");
@@ -130,6 +150,11 @@ namespace GlacierFormats {
 				access_pattern[i]++;
 		}
 
+		//Zero-copy views would bypass the access log.
+		const char* view(int64_t len) override final {
+			return nullptr;
+		}
+
 		const std::vector<char>& getAccessPattern() const {
 			return access_pattern;
 		}
@@ -141,55 +166,214 @@ namespace GlacierFormats {
 
 	};
 
-	class BinaryReader {
-		std::unique_ptr<IBinaryReaderSource> source;
+	//Records read ranges in a ReadCoverage interval set. Much cheaper than LoggedBinaryReaderSource for large resources,
+	//memory use depends on the number of disjoint read ranges instead of the resource size.
+	template<typename Source>
+	class CoverageBinaryReaderSource : public Source {
+		static_assert(std::is_base_of_v<IBinaryReaderSource, Source>);
+
+	private:
+		ReadCoverage coverage;
 
 	public:
-		enum class Endianness { LE, BE };
+		template<typename... Args>
+		CoverageBinaryReaderSource(Args&&... args) : Source(std::forward<Args>(args)...), coverage(Source::size()) {
+		}
 
-		BinaryReader(BinaryReader&& br) noexcept {
-			source = std::move(br.source);
+		void read(char* dst, int64_t len) override final {
+			auto cur = Source::tell();
+			Source::read(dst, len);
+			coverage.add(cur, cur + len);
 		}
 
-		BinaryReader(const std::filesystem::path& path) {
-			source = std::make_unique<BinaryReaderFileSource>(path);
+		const char* view(int64_t len) override final {
+			auto cur = Source::tell();
+			const char* ptr = Source::view(len);
+			if (ptr)
+				coverage.add(cur, cur + len);
+			return ptr;
 		}
 
-		//Doesn't transfer ownership of data.
-		BinaryReader(const char* data, int64_t data_size) {
-			source = std::make_unique<BinaryReaderBufferSource>(data, data_size);
+		const ReadCoverage& getCoverage() const {
+			return coverage;
+		}
+	};
+
+	//Bounds check policy of BasicBinaryReaderSpanSource. Unchecked sources only assert in debug builds and must only be used 
+	//over ranges that were validated up front, see readValidated.
+	enum class BoundsCheck {
+		Checked,
+		Unchecked
+	};
+
+	//Non-virtual buffer source for BasicBinaryReader. Used for the fast reader path, reads compile down to a bounds check 
+	//and a fixed size copy. Can be used over plain buffers and memory mapped files.
+	template<BoundsCheck check>
+	class BasicBinaryReaderSpanSource {
+	private:
+		std::unique_ptr<char[]> owned_read_buffer;
+
+		const char* read_buffer;
+		int64_t buffer_size;
+		int64_t cur;
+
+		void checkBounds(int64_t len) const {
+			if constexpr (check == BoundsCheck::Checked) {
+				if (len > buffer_size - cur)
+					throw InvalidArgumentsException("Out of bounds read");
+			}
+			else {
+				assert(len <= buffer_size - cur);
+			}
+		}
+
+	public:
+		//Non owning constructor
+		BasicBinaryReaderSpanSource(const char* data, int64_t data_size) : owned_read_buffer(nullptr), read_buffer(data), buffer_size(data_size), cur(0) {
+		}
+
+		//Owning constructor
+		BasicBinaryReaderSpanSource(std::unique_ptr<char[]> data, int64_t data_size) : owned_read_buffer(std::move(data)), buffer_size(data_size), cur(0) {
+			read_buffer = owned_read_buffer.get();
+		}
+
+		void read(char* dst, int64_t len) {
+			checkBounds(len);
+			std::memcpy(dst, &read_buffer[cur], len);
+			cur += len;
+		}
+
+		void peek(char* dst, int64_t len) {
+			checkBounds(len);
+			std::memcpy(dst, &read_buffer[cur], len);
+		}
+
+		const char* view(int64_t len) {
+			checkBounds(len);
+			const char* ptr = &read_buffer[cur];
+			cur += len;
+			return ptr;
+		}
+
+		void seek(int64_t offset) {
+			if constexpr (check == BoundsCheck::Checked) {
+				if (offset > buffer_size)
+					throw InvalidArgumentsException("Out of bounds seek");
+			}
+			else {
+				assert(offset <= buffer_size);
+			}
+			cur = offset;
 		}
 
-		BinaryReader(std::unique_ptr<char[]> data, int64_t data_size) {
-			source = std::make_unique<BinaryReaderBufferSource>(std::move(data), data_size);
+		int64_t tell() const {
+			return cur;
 		}
 
-		BinaryReader(std::unique_ptr<IBinaryReaderSource> source) : source(std::move(source)) {};
+		int64_t size() const {
+			return buffer_size;
+		}
 
-		~BinaryReader() {
-			int a = 0;
+		const char* data() const {
+			return read_buffer;
+		}
+	};
+
+	using BinaryReaderSpanSource = BasicBinaryReaderSpanSource<BoundsCheck::Checked>;
+	using UncheckedBinaryReaderSpanSource = BasicBinaryReaderSpanSource<BoundsCheck::Unchecked>;
+
+	//Adapts a type-erased IBinaryReaderSource to the source interface expected by BasicBinaryReader.
+	class PolymorphicBinaryReaderSource {
+	private:
+		std::unique_ptr<IBinaryReaderSource> source;
+
+	public:
+		PolymorphicBinaryReaderSource(std::unique_ptr<IBinaryReaderSource> source) : source(std::move(source)) {
+		}
+
+		void read(char* dst, int64_t len) {
+			source->read(dst, len);
+		}
+
+		void peek(char* dst, int64_t len) {
+			source->peek(dst, len);
+		}
+
+		const char* view(int64_t len) {
+			return source->view(len);
+		}
+
+		void seek(int64_t offset) {
+			source->seek(offset);
 		}
 
 		int64_t tell() {
 			return source->tell();
 		}
 
+		int64_t size() const {
+			return source->size();
+		}
+
+		const IBinaryReaderSource* get() const {
+			return source.get();
+		}
+	};
+
+	class BinaryReaderBase {
+	public:
+		enum class Endianness { LE, BE };
+	};
+
+	//Binary reader over a statically known source type. The source is held by value so all source calls can be inlined.
+	//Format decoders that are templated on the reader type use this for the fast path, see SpanBinaryReader.
+	template<typename Source>
+	class BasicBinaryReader : public BinaryReaderBase {
+	protected:
+		Source source;
+
+		//Finds the terminator of the null terminated string at the current position with memchr and consumes the string.
+		//Returns nullptr without consuming anything if the source doesn't expose its buffer.
+		const char* viewCString(int64_t& len) {
+			const char* str = source.view(0);
+			if (!str)
+				return nullptr;
+
+			const auto* terminator = static_cast<const char*>(std::memchr(str, 0, source.size() - source.tell()));
+			if (!terminator)
+				throw InvalidArgumentsException("Out of bounds read");
+
+			len = terminator - str;
+			source.view(len + 1);
+			return str;
+		}
+
+	public:
+		explicit BasicBinaryReader(Source source) : source(std::move(source)) {
+		}
+
+		BasicBinaryReader(BasicBinaryReader&&) noexcept = default;
+
+		int64_t tell() {
+			return source.tell();
+		}
+
 		void seek(size_t pos) {
-			source->seek(pos);
+			source.seek(pos);
 		}
 
 		int64_t size() const {
-			return source->size();
+			return source.size();
 		}
 
 		template<typename T>
 		void read(T* arr, int64_t len) {
-			source->read(reinterpret_cast<char*>(arr), sizeof(T) * len);
+			source.read(reinterpret_cast<char*>(arr), sizeof(T) * len);
 		}
 
 		template<typename T>
 		void peek(T* arr, int64_t len) {
-			source->peek(reinterpret_cast<char*>(arr), sizeof(T)* len);
+			source.peek(reinterpret_cast<char*>(arr), sizeof(T)* len);
 		}
 
 		template<typename T>
@@ -206,6 +390,39 @@ namespace GlacierFormats {
 			return value;
 		}
 
+		//Reads count packed records of type T. Buffer backed sources return a view into the source buffer without copying,
+		//other sources read all records with a single read into scratch. The view is valid until scratch or the source changes.
+		template<typename T>
+		ArrayView<T> readArray(size_t count, std::vector<T>& scratch) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			const auto len = static_cast<int64_t>(sizeof(T) * count);
+			const char* ptr = source.view(len);
+			if (ptr && reinterpret_cast<uintptr_t>(ptr) % alignof(T) == 0)
+				return ArrayView<T>(reinterpret_cast<const T*>(ptr), count);
+
+			scratch.resize(count);
+			if (ptr)
+				std::memcpy(scratch.data(), ptr, len);
+			else
+				read(scratch.data(), count);
+			return ArrayView<T>(scratch);
+		}
+
+		//Reads count packed records of type Packed and stores fn(record) to dst[0..count).
+		template<typename Packed, typename Out, typename Fn>
+		void decodeInto(Out* dst, size_t count, Fn&& fn) {
+			std::vector<Packed> scratch;
+			const auto records = readArray<Packed>(count, scratch);
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = fn(records[i]);
+		}
+
+		//Throws if less than len bytes are left in the source.
+		void validateExtent(int64_t len) {
+			if (len < 0 || len > size() - tell())
+				throw InvalidArgumentsException("Out of bounds read");
+		}
+
 		template<unsigned int len, Endianness en>
 		std::string readString() {
 			std::string str(len, '\0');
@@ -216,13 +433,25 @@ namespace GlacierFormats {
 		}
 
 		std::string readCString() {
-			char c = read<char>();
-			std::vector<char> read_buffer(1, c);
-			while (c != 0) {
-				c = read<char>();
-				read_buffer.push_back(c);
-			}
-			return std::string(read_buffer.begin(), read_buffer.end() - 1);
+			int64_t len = 0;
+			if (const char* str = viewCString(len))
+				return std::string(str, len);
+
+			std::string str;
+			for (char c = read<char>(); c != 0; c = read<char>())
+				str.push_back(c);
+			return str;
+		}
+
+		//Reads a null terminated string without copying it if the source exposes its buffer. The returned view excludes the
+		//terminator and points either into the source buffer or into scratch, analogous to readArray.
+		std::string_view readCStringView(std::string& scratch) {
+			int64_t len = 0;
+			if (const char* str = viewCString(len))
+				return std::string_view(str, len);
+
+			scratch = readCString();
+			return scratch;
 		}
 
 		template<unsigned int alignment = 0x10>
@@ -237,8 +466,53 @@ namespace GlacierFormats {
 			GLACIER_ASSERT_TRUE(("BinaryReader, invalid padding error", it == &zero[padding_len]));
 		}
 
+		const Source& getSource() const {
+			return source;
+		}
+	};
+
+	//Type-erased binary reader. Works with any IBinaryReaderSource, including the LoggedBinaryReaderSource debug mixin,
+	//at the cost of one virtual call per read.
+	class BinaryReader : public BasicBinaryReader<PolymorphicBinaryReaderSource> {
+	public:
+		BinaryReader(BinaryReader&& br) noexcept = default;
+
+		BinaryReader(const std::filesystem::path& path) : BasicBinaryReader(PolymorphicBinaryReaderSource(std::make_unique<BinaryReaderFileSource>(path))) {
+		}
+
+		//Doesn't transfer ownership of data.
+		BinaryReader(const char* data, int64_t data_size) : BasicBinaryReader(PolymorphicBinaryReaderSource(std::make_unique<BinaryReaderBufferSource>(data, data_size))) {
+		}
+
+		BinaryReader(std::unique_ptr<char[]> data, int64_t data_size) : BasicBinaryReader(PolymorphicBinaryReaderSource(std::make_unique<BinaryReaderBufferSource>(std::move(data), data_size))) {
+		}
+
+		BinaryReader(std::unique_ptr<IBinaryReaderSource> source) : BasicBinaryReader(PolymorphicBinaryReaderSource(std::move(source))) {};
+
 		const IBinaryReaderSource* getSource() const {
 			return source.get();
 		}
 	};
+
+	//Devirtualized reader over a buffer or memory mapped file.
+	using SpanBinaryReader = BasicBinaryReader<BinaryReaderSpanSource>;
+	using UncheckedSpanBinaryReader = BasicBinaryReader<UncheckedBinaryReaderSpanSource>;
+
+	//Validates that len bytes are left in br and calls fn with a reader for them. SpanBinaryReaders pass an unchecked reader
+	//over the validated range to fn, so hot decode loops run without per-read bounds checks. Other readers pass themselves. 
+	//br is advanced by the number of bytes fn read.
+	template<typename Reader, typename Fn>
+	void readValidated(Reader& br, int64_t len, Fn&& fn) {
+		br.validateExtent(len);
+		if constexpr (std::is_same_v<Reader, SpanBinaryReader>) {
+			const auto begin = br.tell();
+			UncheckedSpanBinaryReader unchecked_br(UncheckedBinaryReaderSpanSource(br.getSource().data(), begin + len));
+			unchecked_br.seek(begin);
+			fn(unchecked_br);
+			br.seek(unchecked_br.tell());
+		}
+		else {
+			fn(br);
+		}
+	}
 }
\ No newline at end of file
@@ -1,10 +1,24 @@
 #pragma once
+#include "Exceptions.h"
 #include <filesystem>
 #include <fstream>
 #include <vector>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace GlacierFormats {
 
+	//Reference to a contiguous block of serialized data. owner keeps the referenced memory alive. Segments without owner
+	//borrow memory from the serialized object and are only valid as long as that object is alive and unmodified.
+	struct BinaryWriterSegment {
+		const char* data;
+		int64_t size;
+		std::shared_ptr<const void> owner;
+	};
+
 	class IBinaryWriterSink {
 	public:
 		virtual void write(const char* read_buffer, int len) = 0;
@@ -13,71 +27,207 @@ namespace GlacierFormats {
 		virtual void close() = 0;
 		virtual std::vector<char> release() = 0;
 
+		//Hint that at least size bytes are going to be written. Sinks are free to ignore it.
+		virtual void reserve(int64_t size) {};
+
+		//Writes data that stays valid while owner is alive. Sinks that can keep references record them instead of copying,
+		//the default implementation copies.
+		virtual void writeReference(const char* data, int64_t len, std::shared_ptr<const void> owner) {
+			while (len > 0) {
+				const int chunk_len = static_cast<int>(std::min<int64_t>(len, std::numeric_limits<int>::max()));
+				write(data, chunk_len);
+				data += chunk_len;
+				len -= chunk_len;
+			}
+		}
+
+		//Returns the written data as list of segments. The default implementation wraps release() in a single segment.
+		virtual std::vector<BinaryWriterSegment> releaseSegments() {
+			auto data = std::make_shared<std::vector<char>>(release());
+			if (data->empty())
+				return {};
+			return { BinaryWriterSegment{ data->data(), static_cast<int64_t>(data->size()), data } };
+		}
+
 		virtual ~IBinaryWriterSink() {};
 	};
 
+	//File sink with its own write buffer. Small writes are collected in the buffer and written to the stream in large blocks.
+	//Seeking back into the buffered range patches the buffer without flushing it, so headers and offset tables can be 
+	//back-patched cheaply as long as they are still buffered.
 	class BinaryWriterFileSink : public IBinaryWriterSink {
 	private:
+		static constexpr size_t default_buffer_capacity = 0x100000;
+
 		std::ofstream ofs;
+		std::vector<char> buffer;
+		size_t buffer_capacity;
+		int64_t buffer_offset;//File offset of buffer[0]
+		int64_t file_end;//End of all data written so far, including buffered data
+		int64_t cur;
+
+		void flush() {
+			if (buffer.empty())
+				return;
+			ofs.seekp(buffer_offset, std::ios::beg);
+			ofs.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+
+		//Data can be added to the buffer if it fits and doesn't leave a gap in front of data that was already written to the file.
+		//Blocks of at least the buffer capacity are written directly, the buffer has to be flushed first so its data isn't 
+		//written over them later.
+		bool isBufferable(int len) const {
+			if (static_cast<size_t>(len) >= buffer_capacity)
+				return false;
+			const int64_t buffer_end = buffer_offset + static_cast<int64_t>(buffer.size());
+			if (cur < buffer_offset || cur + len > buffer_offset + static_cast<int64_t>(buffer_capacity))
+				return false;
+			return cur <= buffer_end || buffer_end == file_end;
+		}
+
 	public:
-		BinaryWriterFileSink(const std::filesystem::path file) {
+		BinaryWriterFileSink(const std::filesystem::path file, size_t buffer_capacity = default_buffer_capacity) 
+			: buffer_capacity(buffer_capacity), buffer_offset(0), file_end(0), cur(0) {
 			ofs.exceptions(std::ios::failbit | std::ios::badbit);
 			ofs.open(file, std::ios::binary);
+			buffer.reserve(buffer_capacity);
 		}
 
 		~BinaryWriterFileSink() {
-			if (ofs.is_open())
-				ofs.close();
+			if (!ofs.is_open())
+				return;
+			try {
+				close();
+			}
+			catch (...) {}
 		}
 
 		void write(const char* read_buffer, int len) override final {
-			ofs.write(read_buffer, len);
+			if (len <= 0)
+				return;
+
+			if (!isBufferable(len)) {
+				flush();
+				buffer_offset = cur;
+			}
+
+			if (static_cast<size_t>(len) >= buffer_capacity) {
+				ofs.seekp(cur, std::ios::beg);
+				ofs.write(read_buffer, len);
+			}
+			else {
+				const size_t pos = static_cast<size_t>(cur - buffer_offset);
+				if (pos + len > buffer.size())
+					buffer.resize(pos + len);
+				std::memcpy(&buffer[pos], read_buffer, len);
+			}
+
+			cur += len;
+			file_end = std::max(file_end, cur);
+		}
+
+		//Large blocks are written to the stream directly, without going through the write buffer.
+		void writeReference(const char* data, int64_t len, std::shared_ptr<const void> owner) override final {
+			if (len < static_cast<int64_t>(buffer_capacity)) {
+				write(data, static_cast<int>(len));
+				return;
+			}
+
+			flush();
+			buffer_offset = cur;
+			ofs.seekp(cur, std::ios::beg);
+			ofs.write(data, len);
+			cur += len;
+			file_end = std::max(file_end, cur);
 		}
 
 		void seek(int64_t offset) override final {
-			ofs.seekp(offset, std::ios::beg);
+			cur = offset;
 		}
 
 		int64_t tell() override final {
-			return static_cast<int64_t>(ofs.tellp());
+			return cur;
 		}
 
 		void close() override final {
+			if (!ofs.is_open())
+				return;
+			flush();
 			ofs.close();
 		}
 
 		std::vector<char> release() override final {
-			ofs.close();
+			close();
 			return std::vector<char>();
 		}
 	};
 
+	//Pool of reusable write buffers. Buffers released by a BinaryWriter can be handed back with recycle
+	//and are reused with their capacity by later writers that were constructed with the same arena.
+	class BinaryWriterBufferArena {
+	private:
+		std::mutex mutex;
+		std::vector<std::vector<char>> buffers;
+
+	public:
+		//Returns an empty buffer, preferably one with a capacity of at least capacity_hint.
+		std::vector<char> acquire(size_t capacity_hint) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (buffers.empty())
+				return std::vector<char>();
+
+			auto it = std::find_if(buffers.begin(), buffers.end(), [capacity_hint](const std::vector<char>& buffer) { return buffer.capacity() >= capacity_hint; });
+			if (it == buffers.end())
+				it = std::max_element(buffers.begin(), buffers.end(), [](const std::vector<char>& a, const std::vector<char>& b) { return a.capacity() < b.capacity(); });
+
+			auto buffer = std::move(*it);
+			buffers.erase(it);
+			return buffer;
+		}
+
+		void recycle(std::vector<char> buffer) {
+			if (!buffer.capacity())
+				return;
+			buffer.clear();
+			std::lock_guard<std::mutex> lock(mutex);
+			buffers.push_back(std::move(buffer));
+		}
+	};
+
 	class BinaryWriterBufferSink : public IBinaryWriterSink {
 	private:
+		static constexpr size_t min_capacity = 0x100;
+
 		std::vector<char> data;
 		int64_t cur;
 
-		void resizeIfNecessary(int write_len) {
-			if (cur + write_len > data.size())
-				data.resize(cur + write_len);
+		//Grows the capacity geometrically so a sequence of small writes doesn't reallocate on every write.
+		void resizeIfNecessary(size_t size) {
+			if (size <= data.size())
+				return;
+			if (size > data.capacity())
+				data.reserve(std::max({ size, 2 * data.capacity(), min_capacity }));
+			data.resize(size);
 		}
 
 	public:
-		BinaryWriterBufferSink() : cur(0) {
-
+		BinaryWriterBufferSink(size_t reserve_hint = 0, BinaryWriterBufferArena* arena = nullptr) : cur(0) {
+			if (arena)
+				data = arena->acquire(reserve_hint);
+			data.reserve(reserve_hint);
 		}
 
 		void write(const char* read_buffer, int len) override final {
 			if (!len)
 				return;
-			resizeIfNecessary(len);
+			resizeIfNecessary(cur + len);
 			memcpy_s(&data[cur], len, read_buffer, len);
 			cur += len;
 		}
 
 		void seek(int64_t offset) override final {
-			if (offset > data.size())
-				data.resize(offset);
+			resizeIfNecessary(offset);
 			cur = offset;
 		}
 
@@ -88,12 +238,228 @@ namespace GlacierFormats {
 		void close() override final {
 			return;
 		}
+
+		void reserve(int64_t size) override final {
+			if (size > 0 && static_cast<size_t>(size) > data.capacity())
+				data.reserve(size);
+		}
 		
+		//Hands out the written data without copying. The returned buffer may have spare capacity.
 		std::vector<char> release() override final {
+			cur = 0;
 			return std::move(data);
 		}
 	};
 
+	//Scatter-gather sink. Regular writes are collected in owned chunks, referenced data is recorded as segment without copying.
+	//Data written with write can be back-patched, referenced data can't.
+	class BinaryWriterSegmentSink : public IBinaryWriterSink {
+	private:
+		//References to small blocks are copied, segments aren't worth the bookkeeping for those.
+		static constexpr int64_t min_reference_size = 0x1000;
+
+		struct Entry {
+			int64_t offset;
+			std::shared_ptr<std::vector<char>> chunk;//Owned data, nullptr for references
+			BinaryWriterSegment reference;
+
+			int64_t size() const {
+				return chunk ? static_cast<int64_t>(chunk->size()) : reference.size;
+			}
+		};
+
+		std::vector<Entry> entries;
+		int64_t cur;
+		int64_t end;
+
+		std::vector<char>& currentChunk() {
+			if (entries.empty() || !entries.back().chunk)
+				entries.push_back(Entry{ end, std::make_shared<std::vector<char>>(), BinaryWriterSegment{} });
+			return *entries.back().chunk;
+		}
+
+		//Fills the gap left by seeking past the end with zeros.
+		void fillGap() {
+			if (cur <= end)
+				return;
+			auto& chunk = currentChunk();
+			chunk.resize(chunk.size() + (cur - end), 0);
+			end = cur;
+		}
+
+		void append(const char* data, int64_t len) {
+			auto& chunk = currentChunk();
+			chunk.insert(chunk.end(), data, data + len);
+			end += len;
+		}
+
+		void patch(const char* data, int64_t len) {
+			auto it = std::upper_bound(entries.begin(), entries.end(), cur, [](int64_t offset, const Entry& entry) { return offset < entry.offset; });
+			--it;
+
+			int64_t pos = cur;
+			while (len > 0) {
+				if (!it->chunk)
+					throw InvalidArgumentsException("Referenced segments can't be overwritten");
+				const int64_t entry_pos = pos - it->offset;
+				const int64_t patch_len = std::min(len, it->size() - entry_pos);
+				std::memcpy(it->chunk->data() + entry_pos, data, patch_len);
+				data += patch_len;
+				pos += patch_len;
+				len -= patch_len;
+				++it;
+			}
+		}
+
+	public:
+		BinaryWriterSegmentSink() : cur(0), end(0) {
+		}
+
+		void write(const char* read_buffer, int len) override final {
+			if (len <= 0)
+				return;
+			fillGap();
+
+			const int64_t patch_len = std::min<int64_t>(len, end - cur);
+			if (patch_len > 0)
+				patch(read_buffer, patch_len);
+			if (len > patch_len)
+				append(read_buffer + patch_len, len - patch_len);
+			cur += len;
+		}
+
+		void writeReference(const char* data, int64_t len, std::shared_ptr<const void> owner) override final {
+			if (len < min_reference_size || cur < end) {
+				IBinaryWriterSink::writeReference(data, len, std::move(owner));
+				return;
+			}
+			fillGap();
+
+			entries.push_back(Entry{ end, nullptr, BinaryWriterSegment{ data, len, std::move(owner) } });
+			end += len;
+			cur = end;
+		}
+
+		void seek(int64_t offset) override final {
+			cur = offset;
+		}
+
+		int64_t tell() override final {
+			return cur;
+		}
+
+		void close() override final {
+			return;
+		}
+
+		//Gathers all segments into a single buffer.
+		std::vector<char> release() override final {
+			std::vector<char> data(end);
+			for (const auto& entry : entries) {
+				const char* src = entry.chunk ? entry.chunk->data() : entry.reference.data;
+				std::memcpy(data.data() + entry.offset, src, entry.size());
+			}
+			entries.clear();
+			cur = end = 0;
+			return data;
+		}
+
+		std::vector<BinaryWriterSegment> releaseSegments() override final {
+			std::vector<BinaryWriterSegment> segments;
+			segments.reserve(entries.size());
+			for (auto& entry : entries) {
+				if (entry.chunk)
+					segments.push_back(BinaryWriterSegment{ entry.chunk->data(), entry.size(), entry.chunk });
+				else
+					segments.push_back(std::move(entry.reference));
+			}
+			entries.clear();
+			cur = end = 0;
+			return segments;
+		}
+	};
+
+	//Sink that doesn't store any data and only keeps track of the extent of the written data.
+	//Used to determine the exact size of serialized resources up front.
+	class BinaryWriterCountingSink : public IBinaryWriterSink {
+	private:
+		int64_t cur;
+		int64_t end;
+
+	public:
+		BinaryWriterCountingSink() : cur(0), end(0) {
+		}
+
+		void write(const char* read_buffer, int len) override final {
+			cur += len;
+			end = std::max(end, cur);
+		}
+
+		void seek(int64_t offset) override final {
+			cur = offset;
+		}
+
+		int64_t tell() override final {
+			return cur;
+		}
+
+		void close() override final {
+			return;
+		}
+
+		std::vector<char> release() override final {
+			return std::vector<char>();
+		}
+
+		int64_t size() const {
+			return end;
+		}
+	};
+
+	//Sink over caller supplied memory of fixed size. Writes past the end throw.
+	class BinaryWriterSpanSink : public IBinaryWriterSink {
+	private:
+		char* data;
+		int64_t data_size;
+		int64_t cur;
+		int64_t end;
+
+	public:
+		BinaryWriterSpanSink(char* data, int64_t data_size) : data(data), data_size(data_size), cur(0), end(0) {
+		}
+
+		void write(const char* read_buffer, int len) override final {
+			if (len <= 0)
+				return;
+			if (cur < 0 || cur + len > data_size)
+				throw InvalidArgumentsException("Out of bounds write");
+			std::memcpy(&data[cur], read_buffer, len);
+			cur += len;
+			end = std::max(end, cur);
+		}
+
+		void seek(int64_t offset) override final {
+			cur = offset;
+		}
+
+		int64_t tell() override final {
+			return cur;
+		}
+
+		void close() override final {
+			return;
+		}
+
+		std::vector<char> release() override final {
+			return std::vector<char>();
+		}
+
+		//Extent of the written data
+		int64_t size() const {
+			return end;
+		}
+	};
+
 	class BinaryWriter {
 	private:
 		std::unique_ptr<IBinaryWriterSink> sink;
@@ -107,6 +473,14 @@ namespace GlacierFormats {
 			sink = std::make_unique<BinaryWriterBufferSink>();
 		}
 
+		BinaryWriter(std::unique_ptr<IBinaryWriterSink> sink) : sink(std::move(sink)) {
+		}
+
+		//Buffer writer with an initial capacity of reserve_hint bytes. If an arena is passed, the buffer is taken from the arena.
+		explicit BinaryWriter(size_t reserve_hint, BinaryWriterBufferArena* arena = nullptr) {
+			sink = std::make_unique<BinaryWriterBufferSink>(reserve_hint, arena);
+		}
+
 		template<typename T>
 		void write(const T& value) {
 			static_assert(std::is_trivially_copyable_v<T>);
@@ -135,6 +509,21 @@ namespace GlacierFormats {
 			sink->seek(offset);
 		}
 
+		void reserve(int64_t size) {
+			sink->reserve(size);
+		}
+
+		//Writes data without copying it if the sink supports references, see BinaryWriterSegmentSink.
+		//Without owner, data has to stay valid until the written segments are consumed.
+		void writeReference(const char* data, int64_t len, std::shared_ptr<const void> owner = nullptr) {
+			sink->writeReference(data, len, std::move(owner));
+		}
+
+		void writeSegments(const std::vector<BinaryWriterSegment>& segments) {
+			for (const auto& segment : segments)
+				sink->writeReference(segment.data, segment.size, segment.owner);
+		}
+
 		void writeBEString(const std::string& str) {
 			write(str.c_str(), str.length());
 		}
@@ -153,6 +542,10 @@ namespace GlacierFormats {
 		std::vector<char> release() {
 			return std::move(sink->release());
 		}
+
+		std::vector<BinaryWriterSegment> releaseSegments() {
+			return sink->releaseSegments();
+		}
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "BinaryWriter.hpp"
+#include "MemoryMappedFile.h"
+
+namespace GlacierFormats {
+
+	//File sink for outputs with a size that's known up front. The file is created with its final size and mapped,
+	//writes and back-patches are plain copies into the mapping. Writes past the final size throw.
+	class BinaryWriterMappedFileSink : public IBinaryWriterSink {
+	private:
+		std::unique_ptr<WritableMemoryMappedFile> file;
+		int64_t cur;
+
+	public:
+		BinaryWriterMappedFileSink(const std::filesystem::path& path, size_t file_size) : cur(0) {
+			file = std::make_unique<WritableMemoryMappedFile>(path, file_size);
+		}
+
+		void write(const char* read_buffer, int len) override final {
+			if (len <= 0)
+				return;
+			if (!file || cur < 0 || cur + len > static_cast<int64_t>(file->size()))
+				throw InvalidArgumentsException("Out of bounds write");
+			std::memcpy(file->data() + cur, read_buffer, len);
+			cur += len;
+		}
+
+		void seek(int64_t offset) override final {
+			cur = offset;
+		}
+
+		int64_t tell() override final {
+			return cur;
+		}
+
+		void close() override final {
+			if (file)
+				file->close();
+		}
+
+		std::vector<char> release() override final {
+			close();
+			return std::vector<char>();
+		}
+	};
+
+}
@@ -8,7 +8,8 @@ VertexWeights::VertexWeights()  {
 
 	}
 
-	VertexWeights::VertexWeights(BinaryReader* br) {
+	template<typename Reader>
+	VertexWeights::VertexWeights(Reader* br) {
 		unsigned char w_buf[base_weight_count];
 		unsigned char id_buf[base_weight_count];
 
@@ -60,21 +61,80 @@ VertexWeights::VertexWeights()  {
 
 	}
 
-	VertexWeightBuffer::VertexWeightBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh) {
-		for (int vertex_id = 0; vertex_id < prim_submesh->num_vertex; ++vertex_id) {
-			weights.emplace_back(br);
+	VertexWeightBuffer::VertexWeightBuffer(const VertexWeightBuffer& other) : packed(other.packed), compact(other.compact) {
+		//Copies of compact buffers stay compact.
+		if (other.decodesOnAccess())
+			return;
+
+		other.decode();
+		weights = other.weights;
+		//The weights are copied decoded.
+		std::call_once(decode_flag, []() {});
+		cached = true;
+	}
+
+	template<typename Reader>
+	VertexWeightBuffer::VertexWeightBuffer(Reader* br, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode) {
+		packed.resize(prim_submesh->num_vertex * VertexWeights::serialized_size);
+		br->read(packed.data(), packed.size());
+		compact = mode == PrimDecodeMode::Compact;
+		if (mode == PrimDecodeMode::Eager)
+			decode();
+	}
+
+	void VertexWeightBuffer::decodeInto(std::vector<VertexWeights>& out) const {
+		UncheckedSpanBinaryReader br(UncheckedBinaryReaderSpanSource(packed.data(), packed.size()));
+		const auto vertex_count = packed.size() / VertexWeights::serialized_size;
+		out.reserve(vertex_count);
+		for (size_t vertex_id = 0; vertex_id < vertex_count; ++vertex_id) {
+			out.emplace_back(&br);
+		}
+	}
+
+	void VertexWeightBuffer::decode() const {
+		std::call_once(decode_flag, [this]() {
+			if (packed.empty())
+				return;
+			decodeInto(weights);
+			cached.store(true, std::memory_order_release);
+		});
+	}
+
+	const std::vector<VertexWeights>& VertexWeightBuffer::decodedWeights(std::vector<VertexWeights>& scratch) const {
+		if (decodesOnAccess()) {
+			decodeInto(scratch);
+			return scratch;
 		}
+
+		decode();
+		return weights;
+	}
+
+	bool VertexWeightBuffer::decodesOnAccess() const noexcept {
+		return compact && !packed.empty() && !cached.load(std::memory_order_acquire);
+	}
+
+	void VertexWeightBuffer::markModified() {
+		decode();
+		packed = std::vector<char>();
 	}
 
 	void VertexWeightBuffer::serialize(BinaryWriter* bw) const {
+		if (!packed.empty()) {
+			bw->write(packed.data(), packed.size());
+			return;
+		}
+
 		for (const auto& w : weights)
 			w.serialize(bw);
 	}
 
 	std::vector<IMesh::VertexWeight> VertexWeightBuffer::getCanonicalForm() const {
+		std::vector<VertexWeights> scratch;
+		const auto& decoded = decodedWeights(scratch);
 		std::vector<IMesh::VertexWeight> ret;
-		for (int i = 0; i < weights.size(); ++i) {
-			const auto& vertex_weights = weights[i];
+		for (int i = 0; i < decoded.size(); ++i) {
+			const auto& vertex_weights = decoded[i];
 			for (size_t j = 0; j < VertexWeights::size; ++j) {
 				const auto weights = vertex_weights.weights[j];
 				const auto bone_id = vertex_weights.bone_ids[j];
@@ -86,6 +146,7 @@ VertexWeights::VertexWeights()  {
 	}
 
 	void VertexWeightBuffer::setFromCanonicalForm(int vertex_count, const std::vector<IMesh::VertexWeight>& weight_buffer) {
+		markModified();
 		weights.resize(vertex_count, VertexWeights());
 		for (const auto& new_weight : weight_buffer) {
 			auto& vertex_weights = weights[new_weight.vertex_id];
@@ -100,21 +161,37 @@ VertexWeights::VertexWeights()  {
 	}
 
 	VertexWeights& VertexWeightBuffer::operator[](uint32_t idx) {
+		markModified();
 		return weights[idx];
 	}
 
 	const VertexWeights& VertexWeightBuffer::operator[](uint32_t idx) const {
+		decode();
 		return weights[idx];
 	}
 
 	bool VertexWeightBuffer::operator==(const VertexWeightBuffer& other) const {
-		if (weights.size() != other.weights.size())
+		//Serialized weights decode to equal weights iff they are byte identical.
+		if (!packed.empty() && !other.packed.empty())
+			return packed == other.packed;
+
+		std::vector<VertexWeights> scratch, other_scratch;
+		const auto& decoded = decodedWeights(scratch);
+		const auto& other_decoded = other.decodedWeights(other_scratch);
+		if (decoded.size() != other_decoded.size())
 			return false;
 
-		for (int i = 0; i < weights.size(); ++i) {
-			if (!((*this)[i] == other[i]))
+		for (int i = 0; i < decoded.size(); ++i) {
+			if (!(decoded[i] == other_decoded[i]))
 				return false;
 		}
 
 		return true;
 	}
+
+template VertexWeights::VertexWeights(BinaryReader* br);
+template VertexWeights::VertexWeights(SpanBinaryReader* br);
+template VertexWeights::VertexWeights(UncheckedSpanBinaryReader* br);
+template VertexWeightBuffer::VertexWeightBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexWeightBuffer::VertexWeightBuffer(SpanBinaryReader* br, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexWeightBuffer::VertexWeightBuffer(UncheckedSpanBinaryReader* br, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
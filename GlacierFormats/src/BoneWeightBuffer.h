@@ -2,9 +2,12 @@
 
 #include "Vector.h"
 #include "PrimSerializationTypes.h"
+#include "PrimDecodeMode.h"
 #include "IMesh.h"
 
 #include <vector>
+#include <mutex>
+#include <atomic>
 
 namespace GlacierFormats {
 
@@ -18,11 +21,15 @@ namespace GlacierFormats {
 		//Max number of influences per vertex
 		constexpr static unsigned int size = 6;
 
+		//Serialized size in bytes, one weight byte and one bone id per influence.
+		constexpr static size_t serialized_size = 2 * size;
+
 		Vec<float, size> weights;
 		Vec<unsigned char, size> bone_ids;
 
 		VertexWeights();
-		VertexWeights(BinaryReader* br);
+		template<typename Reader>
+		VertexWeights(Reader* br);
 		void serialize(BinaryWriter* bw) const;
 
 		bool operator==(const VertexWeights& other) const;
@@ -33,18 +40,39 @@ namespace GlacierFormats {
 
 	};
 
+	//Buffers read from a resource keep the serialized weights until they are modified, unmodified buffers are written back
+	//verbatim. Lazily constructed buffers decode the weights on first access, compact buffers decode them on every 
+	//getCanonicalForm call. The const operator[] returns a reference into the decoded weights and promotes compact buffers
+	//to cached ones.
 	class VertexWeightBuffer {
 
-		std::vector<VertexWeights> weights;
+		mutable std::vector<VertexWeights> weights;
+
+		//Serialized weights as read from the resource. Empty for modified buffers.
+		std::vector<char> packed;
+		mutable std::once_flag decode_flag;
+		//Set once the serialized weights are decoded into weights.
+		mutable std::atomic<bool> cached = false;
+		bool compact = false;
+
+		//True if the weights are decoded into scratch on every access instead of being cached.
+		bool decodesOnAccess() const noexcept;
+		void decodeInto(std::vector<VertexWeights>& out) const;
+		void decode() const;
+		void markModified();
+		const std::vector<VertexWeights>& decodedWeights(std::vector<VertexWeights>& scratch) const;
 
 	public:
 		VertexWeightBuffer();
-		VertexWeightBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh);
+		VertexWeightBuffer(const VertexWeightBuffer& other);
+		template<typename Reader>
+		VertexWeightBuffer(Reader* br, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode = PrimDecodeMode::Eager);
 		void serialize(BinaryWriter* bw) const;
 
 		std::vector<IMesh::VertexWeight> getCanonicalForm() const;
 		void setFromCanonicalForm(int vertex_count, const std::vector<IMesh::VertexWeight>& weights);
 
+		//Mutable access marks the buffer as modified.
 		VertexWeights& operator[](uint32_t idx);
 		const VertexWeights& operator[](uint32_t idx) const;
 		bool operator==(const VertexWeightBuffer& other) const;
@@ -189,28 +189,33 @@ struct SkinnedMeshPrimitiveContext {
 void CreateMeshPrimitveResources(BufferBuilder& buffer_builder, const GlacierFormats::IMesh* mesh, SkinnedMeshPrimitiveContext& ctx) {
     //Index data
     buffer_builder.AddBufferView(BufferViewTarget::ELEMENT_ARRAY_BUFFER);
-    auto indices = mesh->getIndexBuffer();
-    ctx.index_acc = buffer_builder.AddAccessor(indices, { TYPE_SCALAR, COMPONENT_UNSIGNED_SHORT }).id;//ComponentType has to be unsigned according to spec.
+    std::vector<unsigned short> index_scratch;
+    const auto indices = mesh->indexBufferView(index_scratch);
+    ctx.index_acc = buffer_builder.AddAccessor(indices.data(), indices.size(), { TYPE_SCALAR, COMPONENT_UNSIGNED_SHORT }).id;//ComponentType has to be unsigned according to spec.
 
     //Vertex position data
     buffer_builder.AddBufferView(BufferViewTarget::ARRAY_BUFFER);
-    auto positions = mesh->getVertexBuffer();
+    std::vector<float> position_scratch;
+    const auto positions = mesh->vertexBufferView(position_scratch);
 
     std::vector<float> bb_min(3, std::numeric_limits<float>::max());    //TODO: replace with IMesh bounding box code
     std::vector<float> bb_max(3, std::numeric_limits<float>::min());
-    for (int j = 0; j < 3; ++j) {
-        for (int i = j; i < positions.size(); i += 3) {
-            bb_min[j] = std::min(positions[i], bb_min[j]);
-            bb_max[j] = std::max(positions[i], bb_max[j]);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        for (int j = 0; j < 3; ++j) {
+            bb_min[j] = std::min(positions[i][j], bb_min[j]);
+            bb_max[j] = std::max(positions[i][j], bb_max[j]);
         }
     }
 
-    ctx.vertex_acc = buffer_builder.AddAccessor(positions, { TYPE_VEC3, COMPONENT_FLOAT, false, bb_min, bb_max }).id;
+    std::vector<float> packed_position_scratch;
+    const auto packed_positions = positions.contiguous(packed_position_scratch);
+    ctx.vertex_acc = buffer_builder.AddAccessor(packed_positions.data(), positions.size(), { TYPE_VEC3, COMPONENT_FLOAT, false, bb_min, bb_max }).id;
 
     //Normals
     buffer_builder.AddBufferView();
-    auto normals = mesh->getNormals();
-    ctx.normal_acc = buffer_builder.AddAccessor(normals, { TYPE_VEC3, COMPONENT_FLOAT }).id;
+    std::vector<float> normal_scratch, packed_normal_scratch;
+    const auto normals = mesh->normalsView(normal_scratch).contiguous(packed_normal_scratch);
+    ctx.normal_acc = buffer_builder.AddAccessor(normals.data(), normals.size() / 3, { TYPE_VEC3, COMPONENT_FLOAT }).id;
 
     //Tangents
     buffer_builder.AddBufferView();
@@ -232,7 +237,8 @@ void CreateMeshPrimitveResources(BufferBuilder& buffer_builder, const GlacierFor
     if (!ctx.is_weighted_mesh)
         return;
 
-    const auto& bone_weights = mesh->getBoneWeights();
+    std::vector<GlacierFormats::IMesh::VertexWeight> bone_weight_scratch;
+    const auto bone_weights = mesh->boneWeightsView(bone_weight_scratch);
     constexpr int influence_count = 4;//Count of bones that can influence a single vertex per ACCESSOR_JOINTS_X / ACCESSOR_WEIGHTS_X.
 
     std::vector<short> joints0(mesh->vertexCount() * influence_count, 0);
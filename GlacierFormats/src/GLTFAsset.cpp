@@ -242,7 +242,7 @@ GLTFAsset::GLTFAsset(const std::filesystem::path& path, const std::unordered_map
                     }
                 }
                 //TODO: Normalization required? Read spec.
-                gltf_mesh->setBoneWeight(bone_weights);
+                gltf_mesh->setBoneWeight(std::move(bone_weights));
             }
 
             meshes_.push_back(std::move(gltf_mesh));
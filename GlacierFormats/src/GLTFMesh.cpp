@@ -1,5 +1,6 @@
 #include <string>
 #include <stdexcept>
+#include <utility>
 #include "GLTFMesh.h"
 
 using namespace GlacierFormats;
@@ -46,6 +47,30 @@ std::vector<GlacierFormats::IMesh::VertexWeight> GLTFMesh::getBoneWeights() cons
     return weights;
 }
 
+StridedArrayView<float> GLTFMesh::vertexBufferView(std::vector<float>& scratch) const {
+    return StridedArrayView<float>(positions, IMesh::vertex_size);
+}
+
+ArrayView<unsigned short> GLTFMesh::indexBufferView(std::vector<unsigned short>& scratch) const {
+    return index_buffer;
+}
+
+StridedArrayView<float> GLTFMesh::normalsView(std::vector<float>& scratch) const {
+    return StridedArrayView<float>(normals, IMesh::normal_size);
+}
+
+StridedArrayView<float> GLTFMesh::tangentsView(std::vector<float>& scratch) const {
+    return StridedArrayView<float>(tangents, IMesh::tangent_size);
+}
+
+StridedArrayView<float> GLTFMesh::uvsView(std::vector<float>& scratch) const {
+    return StridedArrayView<float>(uvs, IMesh::uv_size);
+}
+
+ArrayView<GlacierFormats::IMesh::VertexWeight> GLTFMesh::boneWeightsView(std::vector<VertexWeight>& scratch) const {
+    return weights;
+}
+
 void GLTFMesh::setVertexBuffer(const std::vector<float>& pos) {
     positions = pos;
 }
@@ -70,6 +95,30 @@ void GLTFMesh::setBoneWeight(const std::vector<VertexWeight>& weights_) {
     weights = weights_;
 }
 
+void GLTFMesh::setVertexBuffer(std::vector<float>&& pos) {
+    positions = std::move(pos);
+}
+
+void GLTFMesh::setIndexBuffer(std::vector<unsigned short>&& indices_) {
+    index_buffer = std::move(indices_);
+}
+
+void GLTFMesh::setNormals(std::vector<float>&& normals_) {
+    normals = std::move(normals_);
+}
+
+void GLTFMesh::setTangents(std::vector<float>&& tangents_) {
+    tangents = std::move(tangents_);
+}
+
+void GLTFMesh::setUVs(std::vector<float>&& uvs_) {
+    uvs = std::move(uvs_);
+}
+
+void GLTFMesh::setBoneWeight(std::vector<VertexWeight>&& weights_) {
+    weights = std::move(weights_);
+}
+
 void GLTFMesh::setName(const std::string& name) {
     name_ = name;
 }
@@ -28,6 +28,13 @@ namespace GlacierFormats {
 		[[nodiscard]] std::vector<float> getUVs() const override final;
 		[[nodiscard]] std::vector<VertexWeight> getBoneWeights() const override final;
 
+		[[nodiscard]] StridedArrayView<float> vertexBufferView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] ArrayView<unsigned short> indexBufferView(std::vector<unsigned short>& scratch) const override final;
+		[[nodiscard]] StridedArrayView<float> normalsView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] StridedArrayView<float> tangentsView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] StridedArrayView<float> uvsView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] ArrayView<VertexWeight> boneWeightsView(std::vector<VertexWeight>& scratch) const override final;
+
 		void setVertexBuffer(const std::vector<float>&) override final;
 		void setIndexBuffer(const std::vector<unsigned short>&) override final;
 		void setNormals(const std::vector<float>&) override final;
@@ -35,5 +42,12 @@ namespace GlacierFormats {
 		void setUVs(const std::vector<float>&) override final;
 		void setBoneWeight(const std::vector<VertexWeight>&) override final;
 		void setName(const std::string&) override final;
+
+		void setVertexBuffer(std::vector<float>&&) override final;
+		void setIndexBuffer(std::vector<unsigned short>&&) override final;
+		void setNormals(std::vector<float>&&) override final;
+		void setTangents(std::vector<float>&&) override final;
+		void setUVs(std::vector<float>&&) override final;
+		void setBoneWeight(std::vector<VertexWeight>&&) override final;
 	};
 }
\ No newline at end of file
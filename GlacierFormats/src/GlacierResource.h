@@ -2,6 +2,7 @@
 #include <memory>
 #include <assert.h>
 #include <filesystem>
+#include <type_traits>
 #include "BinaryReader.hpp"
 #include "BinaryWriter.hpp"
 #include "GlacierTypes.h"
@@ -35,19 +36,31 @@ namespace GlacierFormats {
 			return std::make_unique<T>(br, id);
 		}
 
+		//Resources that provide a SpanBinaryReader constructor are parsed with the devirtualized reader.
 		static std::unique_ptr<T> readFromBuffer(std::unique_ptr<char[]> buf, size_t buf_len, RuntimeId id) {
-			BinaryReader br(std::move(buf), buf_len);
-			return std::make_unique<T>(br, id);
+			if constexpr (std::is_constructible_v<T, SpanBinaryReader&, RuntimeId>) {
+				SpanBinaryReader br(BinaryReaderSpanSource(std::move(buf), buf_len));
+				return std::make_unique<T>(br, id);
+			}
+			else {
+				BinaryReader br(std::move(buf), buf_len);
+				return std::make_unique<T>(br, id);
+			}
 		}
 
 		static std::unique_ptr<T> readFromBuffer(const char* buf, size_t buf_len, RuntimeId id) {
-			BinaryReader br(buf, buf_len);
-			return std::make_unique<T>(br, id);
+			if constexpr (std::is_constructible_v<T, SpanBinaryReader&, RuntimeId>) {
+				SpanBinaryReader br(BinaryReaderSpanSource(buf, buf_len));
+				return std::make_unique<T>(br, id);
+			}
+			else {
+				BinaryReader br(buf, buf_len);
+				return std::make_unique<T>(br, id);
+			}
 		}
 
 		static std::unique_ptr<T> readFromBuffer(const std::vector<char>& buf, RuntimeId id) {
-			BinaryReader br(buf.data(), buf.size());
-			return std::make_unique<T>(br, id);
+			return readFromBuffer(buf.data(), buf.size(), id);
 		}
 
 		void serializeToFile(const std::filesystem::path& file_path) {
@@ -55,13 +68,49 @@ namespace GlacierFormats {
 			reinterpret_cast<T*>(this)->serialize(bw);
 		}
 
+		//Exact size of the serialized resource in bytes. The default implementation serializes into a counting sink,
+		//resources that can compute their size more cheaply provide their own serializedSize.
+		int64_t serializedSize() {
+			auto sink = std::make_unique<BinaryWriterCountingSink>();
+			const auto* counter = sink.get();
+			BinaryWriter bw(std::move(sink));
+			reinterpret_cast<T*>(this)->serialize(bw);
+			return counter->size();
+		}
+
+		//Serializes the resource into caller supplied memory, e.g. a slot in an archive that's being built.
+		//data_size has to be at least serializedSize(). Returns the number of bytes written.
+		int64_t serializeToBuffer(char* data, int64_t data_size) {
+			auto sink = std::make_unique<BinaryWriterSpanSink>(data, data_size);
+			const auto* span = sink.get();
+			BinaryWriter bw(std::move(sink));
+			reinterpret_cast<T*>(this)->serialize(bw);
+			return span->size();
+		}
+
+		//Resources with their own serializedSize are serialized directly into an allocation of the exact size. The default
+		//serializedSize is a full serialization pass, those resources are serialized once into a buffer that's copied instead.
 		int64_t serializeToBuffer(std::unique_ptr<char[]>& data) {
-			BinaryWriter bw;
+			if constexpr (std::is_same_v<decltype(&T::serializedSize), decltype(&GlacierResource<T>::serializedSize)>) {
+				const auto buffer = serializeToBuffer();
+				data = std::make_unique<char[]>(buffer.size());
+				std::copy(buffer.begin(), buffer.end(), data.get());
+				return buffer.size();
+			}
+			else {
+				const auto size = reinterpret_cast<T*>(this)->serializedSize();
+				data = std::make_unique<char[]>(size);
+				serializeToBuffer(data.get(), size);
+				return size;
+			}
+		}
+
+		//Serializes the resource without copying large buffers. Segments without owner reference memory of this resource
+		//and are only valid as long as the resource is alive and unmodified.
+		std::vector<BinaryWriterSegment> serializeToSegments() {
+			BinaryWriter bw(std::make_unique<BinaryWriterSegmentSink>());
 			reinterpret_cast<T*>(this)->serialize(bw);
-			auto buffer = bw.release();
-			data = std::make_unique<char[]>(buffer.size());
-			memcpy_s(data.get(), buffer.size(), buffer.data(), buffer.size());
-			return buffer.size();
+			return bw.releaseSegments();
 		}
 
 		std::vector<char> serializeToBuffer() {
@@ -1,4 +1,5 @@
 #include "IMesh.h"
+#include <utility>
 
 namespace GlacierFormats {
 
@@ -10,6 +11,60 @@ namespace GlacierFormats {
 		dst->setUVs(src->getUVs());
 		auto bone_weights = src->getBoneWeights();
 		if (bone_weights.size())
-			dst->setBoneWeight(bone_weights);
+			dst->setBoneWeight(std::move(bone_weights));
+	}
+
+	StridedArrayView<float> IMesh::vertexBufferView(std::vector<float>& scratch) const {
+		scratch = getVertexBuffer();
+		return StridedArrayView<float>(scratch, vertex_size);
+	}
+
+	ArrayView<unsigned short> IMesh::indexBufferView(std::vector<unsigned short>& scratch) const {
+		scratch = getIndexBuffer();
+		return scratch;
+	}
+
+	StridedArrayView<float> IMesh::normalsView(std::vector<float>& scratch) const {
+		scratch = getNormals();
+		return StridedArrayView<float>(scratch, normal_size);
+	}
+
+	StridedArrayView<float> IMesh::tangentsView(std::vector<float>& scratch) const {
+		scratch = getTangents();
+		return StridedArrayView<float>(scratch, tangent_size);
+	}
+
+	StridedArrayView<float> IMesh::uvsView(std::vector<float>& scratch) const {
+		scratch = getUVs();
+		return StridedArrayView<float>(scratch, uv_size);
+	}
+
+	ArrayView<IMesh::VertexWeight> IMesh::boneWeightsView(std::vector<VertexWeight>& scratch) const {
+		scratch = getBoneWeights();
+		return scratch;
+	}
+
+	void IMesh::setVertexBuffer(std::vector<float>&& vertices) {
+		setVertexBuffer(static_cast<const std::vector<float>&>(vertices));
+	}
+
+	void IMesh::setIndexBuffer(std::vector<unsigned short>&& indices) {
+		setIndexBuffer(static_cast<const std::vector<unsigned short>&>(indices));
+	}
+
+	void IMesh::setNormals(std::vector<float>&& normals) {
+		setNormals(static_cast<const std::vector<float>&>(normals));
+	}
+
+	void IMesh::setTangents(std::vector<float>&& tangents) {
+		setTangents(static_cast<const std::vector<float>&>(tangents));
+	}
+
+	void IMesh::setUVs(std::vector<float>&& uvs) {
+		setUVs(static_cast<const std::vector<float>&>(uvs));
+	}
+
+	void IMesh::setBoneWeight(std::vector<VertexWeight>&& weights) {
+		setBoneWeight(static_cast<const std::vector<VertexWeight>&>(weights));
 	}
 }
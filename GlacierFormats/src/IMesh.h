@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include "ArrayView.h"
 
 namespace GlacierFormats {
 
@@ -19,6 +20,7 @@ namespace GlacierFormats {
 
 		static constexpr int vertex_size = 3;
 		static constexpr int normal_size = 3;
+		static constexpr int tangent_size = 4;
 		static constexpr int uv_size = 2;
 
 		static void convert(IMesh* dst, const IMesh* src);
@@ -33,7 +35,17 @@ namespace GlacierFormats {
 		[[nodiscard]] virtual std::vector<float> getUVs() const = 0;
 		[[nodiscard]] virtual std::vector<VertexWeight> getBoneWeights() const = 0;
 
-		//TODO: add move variants of all the setters
+		//Non-owning views of the same data as the getters. Meshes return views into their own storage if they store the data in
+		//the canonical layout and strided views if the values are stored with padding. Data that has to be converted is written
+		//to scratch. Views are valid until the mesh or scratch changes. The default implementations copy the getter results 
+		//into scratch.
+		[[nodiscard]] virtual StridedArrayView<float> vertexBufferView(std::vector<float>& scratch) const;
+		[[nodiscard]] virtual ArrayView<unsigned short> indexBufferView(std::vector<unsigned short>& scratch) const;
+		[[nodiscard]] virtual StridedArrayView<float> normalsView(std::vector<float>& scratch) const;
+		[[nodiscard]] virtual StridedArrayView<float> tangentsView(std::vector<float>& scratch) const;
+		[[nodiscard]] virtual StridedArrayView<float> uvsView(std::vector<float>& scratch) const;
+		[[nodiscard]] virtual ArrayView<VertexWeight> boneWeightsView(std::vector<VertexWeight>& scratch) const;
+
 		virtual void setVertexBuffer(const std::vector<float>&) = 0;
 		virtual void setIndexBuffer(const std::vector<unsigned short>&) = 0;
 		virtual void setNormals(const std::vector<float>&) = 0;
@@ -41,6 +53,15 @@ namespace GlacierFormats {
 		virtual void setUVs(const std::vector<float>&) = 0;
 		virtual void setBoneWeight(const std::vector<VertexWeight>&) = 0;
 		virtual void setName(const std::string& name) = 0;
+
+		//Move variants of the setters. Meshes that store the data in the canonical layout take over the buffer, the default 
+		//implementations call the copying setters.
+		virtual void setVertexBuffer(std::vector<float>&&);
+		virtual void setIndexBuffer(std::vector<unsigned short>&&);
+		virtual void setNormals(std::vector<float>&&);
+		virtual void setTangents(std::vector<float>&&);
+		virtual void setUVs(std::vector<float>&&);
+		virtual void setBoneWeight(std::vector<VertexWeight>&&);
 	};
 
 }
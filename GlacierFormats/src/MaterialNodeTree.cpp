@@ -57,11 +57,12 @@ Property::PropertyVariantType readPropData(const SProperty& prop, BinaryReader&
 		variant = *reinterpret_cast<const T*>(&prop.data);
 	}
 	else {
+		//Validate the whole array once, then copy it in bulk.
 		br.seek(prop.data);
-		std::vector<T> vec;
-		for (int i = 0; i < prop.size; ++i)
-			vec.push_back(br.read<T>());
-		variant = vec;
+		br.validateExtent(static_cast<int64_t>(prop.size) * sizeof(T));
+		std::vector<T> scratch;
+		const auto view = br.readArray<T>(prop.size, scratch);
+		variant = std::vector<T>(view.begin(), view.end());
 	}
 
 	return variant;
@@ -220,6 +221,8 @@ PropertyBinder::PropertyBinder(BinaryReader& br, const SProperty& sprop) {
 	name_ = sprop.name;
 
 	br.seek(sprop.data);
+	br.validateExtent(static_cast<int64_t>(sprop.size) * sizeof(SProperty));
+	children.reserve(sprop.size);
 	for (int i = 0; i < sprop.size; ++i) {
 		children.emplace_back(br);
 		property_binder_map[children.back().name()] = &children.back();
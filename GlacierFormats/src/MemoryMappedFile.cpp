@@ -0,0 +1,100 @@
+#include "MemoryMappedFile.h"
+#include <stdexcept>
+
+using namespace GlacierFormats;
+
+	MemoryMappedFile::MemoryMappedFile(const std::filesystem::path& path) : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), view_size(0) {
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Failed to open file for mapping: " + path.generic_string());
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size)) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to get file size: " + path.generic_string());
+		}
+
+		//Zero sized files can't be mapped.
+		view_size = static_cast<size_t>(file_size.QuadPart);
+		if (view_size == 0)
+			return;
+
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to create file mapping: " + path.generic_string());
+		}
+
+		view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!view) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map view of file: " + path.generic_string());
+		}
+	}
+
+	MemoryMappedFile::~MemoryMappedFile() {
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+
+	const char* MemoryMappedFile::data() const noexcept {
+		return view;
+	}
+
+	size_t MemoryMappedFile::size() const noexcept {
+		return view_size;
+	}
+
+	WritableMemoryMappedFile::WritableMemoryMappedFile(const std::filesystem::path& path, size_t size) : file(INVALID_HANDLE_VALUE), mapping(nullptr), view(nullptr), view_size(size) {
+		file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			throw std::runtime_error("Failed to create file for mapping: " + path.generic_string());
+
+		//Zero sized files can't be mapped.
+		if (view_size == 0)
+			return;
+
+		const auto size_high = static_cast<DWORD>(static_cast<uint64_t>(size) >> 32);
+		const auto size_low = static_cast<DWORD>(static_cast<uint64_t>(size) & 0xFFFFFFFF);
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, size_high, size_low, nullptr);
+		if (!mapping) {
+			CloseHandle(file);
+			throw std::runtime_error("Failed to create file mapping: " + path.generic_string());
+		}
+
+		view = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+		if (!view) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map view of file: " + path.generic_string());
+		}
+	}
+
+	WritableMemoryMappedFile::~WritableMemoryMappedFile() {
+		close();
+	}
+
+	char* WritableMemoryMappedFile::data() noexcept {
+		return view;
+	}
+
+	size_t WritableMemoryMappedFile::size() const noexcept {
+		return view_size;
+	}
+
+	void WritableMemoryMappedFile::close() {
+		if (view)
+			UnmapViewOfFile(view);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		view = nullptr;
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+	}
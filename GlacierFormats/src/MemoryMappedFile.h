@@ -0,0 +1,46 @@
+#pragma once
+#include <windows.h>
+#include <filesystem>
+
+namespace GlacierFormats {
+
+	//Read-only memory mapping of a whole file. Empty files are valid and map to data() == nullptr, size() == 0.
+	class MemoryMappedFile {
+	private:
+		HANDLE file;
+		HANDLE mapping;
+		const char* view;
+		size_t view_size;
+
+	public:
+		explicit MemoryMappedFile(const std::filesystem::path& path);
+		MemoryMappedFile(const MemoryMappedFile&) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+		~MemoryMappedFile();
+
+		const char* data() const noexcept;
+		size_t size() const noexcept;
+	};
+
+	//Writable memory mapping of a newly created file with a fixed size. Existing files are overwritten.
+	class WritableMemoryMappedFile {
+	private:
+		HANDLE file;
+		HANDLE mapping;
+		char* view;
+		size_t view_size;
+
+	public:
+		WritableMemoryMappedFile(const std::filesystem::path& path, size_t size);
+		WritableMemoryMappedFile(const WritableMemoryMappedFile&) = delete;
+		WritableMemoryMappedFile& operator=(const WritableMemoryMappedFile&) = delete;
+		~WritableMemoryMappedFile();
+
+		char* data() noexcept;
+		size_t size() const noexcept;
+
+		//Unmaps the file. Dirty pages are written back by the OS.
+		void close();
+	};
+
+}
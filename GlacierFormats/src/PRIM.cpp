@@ -7,23 +7,71 @@
 #include "PrimRenderPrimitiveSerialization.h"
 #include "Exceptions.h"
 #include "PRIM.h"
+#include "ThreadPool.h"
 #include <typeindex>
 #include <utility>
 #include <unordered_map>
+#include <atomic>
 
 
 using namespace GlacierFormats;
 
+namespace {
+
+	std::atomic<PRIM::DecodeMode> default_decode_mode = PRIM::DecodeMode::Eager;
+	std::atomic<ThreadPool*> default_decode_pool = nullptr;
+
+}
+
 	PRIM::PRIM(RuntimeId id) : GlacierResource<PRIM>(id) {
 		//TODO: Initilize manifest?
 	}
 
-	PRIM::PRIM(BinaryReader& br, RuntimeId id) : GlacierResource<PRIM>(id) {
-		auto primary_offset = br.read<uint32_t>();
+	PRIM::PRIM(BinaryReader& br, RuntimeId id) : PRIM(br, id, defaultDecodeMode()) {
+	}
+
+	PRIM::PRIM(SpanBinaryReader& br, RuntimeId id) : PRIM(br, id, defaultDecodeMode()) {
+	}
+
+	PRIM::PRIM(BinaryReader& br, RuntimeId id, DecodeMode mode) : GlacierResource<PRIM>(id) {
+		deserialize(br, mode, defaultDecodePool());
+	}
+
+	PRIM::PRIM(SpanBinaryReader& br, RuntimeId id, DecodeMode mode) : GlacierResource<PRIM>(id) {
+		deserialize(br, mode, defaultDecodePool());
+	}
+
+	PRIM::PRIM(BinaryReader& br, RuntimeId id, DecodeMode mode, ThreadPool& pool) : GlacierResource<PRIM>(id) {
+		deserialize(br, mode, &pool);
+	}
+
+	PRIM::PRIM(SpanBinaryReader& br, RuntimeId id, DecodeMode mode, ThreadPool& pool) : GlacierResource<PRIM>(id) {
+		deserialize(br, mode, &pool);
+	}
+
+	PRIM::DecodeMode PRIM::defaultDecodeMode() noexcept {
+		return default_decode_mode.load();
+	}
+
+	void PRIM::setDefaultDecodeMode(DecodeMode mode) noexcept {
+		default_decode_mode.store(mode);
+	}
+
+	ThreadPool* PRIM::defaultDecodePool() noexcept {
+		return default_decode_pool.load();
+	}
+
+	void PRIM::setDefaultDecodePool(ThreadPool* pool) noexcept {
+		default_decode_pool.store(pool);
+	}
+
+	template<typename Reader>
+	void PRIM::deserialize(Reader& br, DecodeMode mode, ThreadPool* pool) {
+		auto primary_offset = br.template read<uint32_t>();
 		br.align();
 
 		br.seek(primary_offset);
-		SPrimObjectHeader prim_object_header = br.read<SPrimObjectHeader>();
+		SPrimObjectHeader prim_object_header = br.template read<SPrimObjectHeader>();
 
 		//SPrimObjectHeader should always be at the end of the resource file. The only exception are speedtree meshes which aren't supported.
 		//This test is not sufficient and could be avoided by simply not aligning but that would mess with the read coverage debug reader.
@@ -45,24 +93,21 @@ using namespace GlacierFormats;
 		br.seek(prim_object_header.object_table);
 		std::vector<uint32_t> object_table;
 		for (int i = 0; i < prim_object_header.num_objects; i++)
-			object_table.push_back(br.read<uint32_t>());
+			object_table.push_back(br.template read<uint32_t>());
 		br.align();
 
 		//printf("%s\n", static_cast<std::string>(id).c_str());
+		//Validate all object headers before any primitive is decoded.
 		for (const auto& object_offset : object_table) {
 			br.seek(object_offset);
-			auto object = br.peek<SPrimObject>();
+			auto object = br.template peek<SPrimObject>();
 			object.Assert();
 			GLACIER_ASSERT_TRUE(object.type == SPrimHeader::EPrimType::PTMESH);
 
-			RenderPrimitiveDeserializer deserializer;
-			std::unique_ptr<ZRenderPrimitive> prim = nullptr;
 			switch (object.sub_type) {
-			case SPrimObject::SUBTYPE::SUBTYPE_STANDARD:		
+			case SPrimObject::SUBTYPE::SUBTYPE_STANDARD:
 			case SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED:
 			case SPrimObject::SUBTYPE::SUBTYPE_LINKED:
-				prim = deserializer.deserializeMesh(&br, &prim_object_header);
-				primitives.push_back(std::move(prim));
 				break;
 			case SPrimObject::SUBTYPE::SUBTYPE_SPEEDTREE:
 				throw UnsupportedFeatureException("SPrimObject::SUBTYPE_SPEEDTREE not supported");
@@ -72,6 +117,28 @@ using namespace GlacierFormats;
 				break;
 			}
 		}
+
+		RenderPrimitiveDeserializer deserializer;
+		if (pool && object_table.size() > 1) {
+			//Every task decodes from its own reader over the resource buffer. Reads of parallel decodes bypass the source of br, 
+			//coverage and logging readers only see a single read of the whole resource.
+			br.seek(0);
+			std::vector<char> scratch;
+			const auto buffer = br.template readArray<char>(br.size(), scratch);
+
+			primitives.resize(object_table.size());
+			pool->parallelFor(object_table.size(), [&](size_t i) {
+				SpanBinaryReader object_br(BinaryReaderSpanSource(buffer.data(), buffer.size()));
+				object_br.seek(object_table[i]);
+				primitives[i] = deserializer.deserializeMesh(&object_br, &prim_object_header, mode);
+			});
+		}
+		else {
+			for (const auto& object_offset : object_table) {
+				br.seek(object_offset);
+				primitives.push_back(deserializer.deserializeMesh(&br, &prim_object_header, mode));
+			}
+		}
 	}
 
 	PRIM::PRIM(const std::vector<IMesh*>& meshes, RuntimeId id, std::function<void(ZRenderPrimitiveBuilder&, const std::string&)>* build_modifier) : GlacierResource<PRIM>(id) {
@@ -109,18 +176,12 @@ using namespace GlacierFormats;
 		bw.align();
 
 		//Record of serialized resource buffers. Used for buffer reuse support.
-		//key: pair of typeid of serialized record and std::hash of resource buffer
-		//value: offset to resource.
-		std::unordered_map<RecordKey, uint64_t> buffer_records;
-
-		//TODO:
-		//The orginal format also supports the reuse of entire primitives by
-		//pointing the submesh table entry to an existing submesh
-		//In this case only the PrimMesh struct is serialized. 
-		//This optimization is currently not supported in this reimplementation of the serializer
-		//Impl operator== for prim and all it's logical subtypes.
+		RecordTable records;
+
+		//Primitives with equal submeshes only serialize their PrimMesh struct and point it to the submesh table
+		//of the first one, see ZRenderPrimitive::submeshEquals.
 		for (const auto& prim : primitives) {
-			auto off = prim->serialize(&bw, buffer_records);
+			auto off = prim->serialize(&bw, records);
 			object_table.push_back(off);
 		}
 
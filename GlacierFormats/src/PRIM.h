@@ -2,6 +2,7 @@
 #include "GlacierResource.h"
 #include "PrimRenderPrimitive.h"
 #include "PrimManifest.h"
+#include "PrimDecodeMode.h"
 
 #include <vector>
 #include <functional>
@@ -10,6 +11,7 @@ namespace GlacierFormats {
 
 	class BinaryReader;
 	class BinaryWriter;
+	class ThreadPool;
 
 	struct PrimitiveManifest {
 		SPrimObject::SUBTYPE mesh_subtype = static_cast<SPrimObject::SUBTYPE>(0);
@@ -25,19 +27,41 @@ namespace GlacierFormats {
 	//Glacier file format class containing render mesh data and meta data. 
 	class PRIM : public GlacierResource<PRIM> {
 	public:
+		//Controls when and how the vertex streams of parsed primitives are decoded, see PrimDecodeMode.
+		using DecodeMode = PrimDecodeMode;
+
 		PrimManifest manifest;
 
 		std::vector<std::unique_ptr<ZRenderPrimitive>> primitives;
 
+	private:
+		template<typename Reader>
+		void deserialize(Reader& br, DecodeMode mode, ThreadPool* pool);
+
 	public:
 		PRIM(RuntimeId id);
 		PRIM(BinaryReader& br, RuntimeId id);
+		PRIM(SpanBinaryReader& br, RuntimeId id);
+		PRIM(BinaryReader& br, RuntimeId id, DecodeMode mode);
+		PRIM(SpanBinaryReader& br, RuntimeId id, DecodeMode mode);
+		//Reads the object table and mesh headers first and then decodes the primitives concurrently on pool. The order of 
+		//primitives is the same as for sequential decoding.
+		PRIM(BinaryReader& br, RuntimeId id, DecodeMode mode, ThreadPool& pool);
+		PRIM(SpanBinaryReader& br, RuntimeId id, DecodeMode mode, ThreadPool& pool);
 		PRIM(const std::vector<IMesh*>& meshes, RuntimeId id, std::function<void(ZRenderPrimitiveBuilder&, const std::string&)>* build_modifier = nullptr);
 
 		PRIM(const PRIM& prim) = delete;
 		PRIM& operator=(const PRIM& p) = delete;
 		~PRIM();
 
+		//DecodeMode used by constructors that don't take one, e.g. when resources are read through the ResourceRepository.
+		static DecodeMode defaultDecodeMode() noexcept;
+		static void setDefaultDecodeMode(DecodeMode mode) noexcept;
+
+		//Pool used by constructors that don't take one. nullptr, the default, decodes primitives on the calling thread.
+		static ThreadPool* defaultDecodePool() noexcept;
+		static void setDefaultDecodePool(ThreadPool* pool) noexcept;
+
 		bool isWeightedPrim() const;
 
 		void serialize(BinaryWriter& bw);
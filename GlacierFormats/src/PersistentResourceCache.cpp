@@ -0,0 +1,191 @@
+#include "PersistentResourceCache.h"
+#include "MemoryMappedFile.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+using namespace GlacierFormats;
+
+	namespace {
+		//FNV-1a over 64 bit words in four independent lanes, a bytewise hash would dominate the cost of a cache hit.
+		uint64_t payloadChecksum(const char* data, size_t size) {
+			constexpr uint64_t prime = 0x00000100000001B3;
+			uint64_t lanes[4] = { 0xcbf29ce484222325, 0x84222325cbf29ce4, 0xcbf29ce484222325 ^ size, 0x84222325cbf29ce4 ^ size };
+
+			size_t i = 0;
+			for (; i + sizeof(lanes) <= size; i += sizeof(lanes)) {
+				for (size_t lane = 0; lane < 4; ++lane) {
+					uint64_t word;
+					std::memcpy(&word, data + i + lane * sizeof(uint64_t), sizeof(word));
+					lanes[lane] = (lanes[lane] ^ word) * prime;
+				}
+			}
+			for (; i < size; ++i)
+				lanes[0] = (lanes[0] ^ static_cast<uint8_t>(data[i])) * prime;
+
+			uint64_t checksum = lanes[0];
+			for (size_t lane = 1; lane < 4; ++lane)
+				checksum = (checksum ^ lanes[lane]) * prime;
+			return checksum;
+		}
+	}
+
+	bool PersistentResourceCache::Key::operator==(const Key& other) const noexcept {
+		return (runtime_id == other.runtime_id) && (archive == other.archive) && (offset == other.offset);
+	}
+
+	size_t PersistentResourceCache::KeyHash::operator()(const Key& key) const noexcept {
+		return std::hash<uint64_t>{}(key.runtime_id ^ (key.archive * 0x9E3779B97F4A7C15) ^ (key.offset << 1));
+	}
+
+	PersistentResourceCache::PersistentResourceCache(const std::filesystem::path& directory) :
+		pack_path(directory / "payloads.pack"),
+		index_path(directory / "payloads.idx"),
+		pack_size(0) {
+
+		std::filesystem::create_directories(directory);
+		loadIndex();
+
+		pack_writer.open(pack_path, std::ofstream::binary | std::ofstream::app);
+		index_writer.open(index_path, std::ofstream::binary | std::ofstream::app);
+		if (!pack_writer.is_open() || !index_writer.is_open())
+			throw std::runtime_error("Failed to open persistent resource cache in " + directory.generic_string());
+
+		if (std::filesystem::file_size(index_path) == 0) {
+			IndexHeader header{};
+			std::memcpy(header.magic, magic, sizeof(magic));
+			header.version = version;
+			header.record_size = sizeof(IndexRecord);
+			index_writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			index_writer.flush();
+		}
+
+		pack_reader.open(pack_path, std::ifstream::binary);
+	}
+
+	void PersistentResourceCache::loadIndex() {
+		const bool files_exist = std::filesystem::exists(index_path) && std::filesystem::exists(pack_path);
+		const auto index_size = files_exist ? std::filesystem::file_size(index_path) : 0;
+		if (index_size < sizeof(IndexHeader)) {
+			//Missing or unusable cache, start from scratch.
+			std::ofstream(index_path, std::ofstream::binary | std::ofstream::trunc);
+			std::ofstream(pack_path, std::ofstream::binary | std::ofstream::trunc);
+			return;
+		}
+		pack_size = std::filesystem::file_size(pack_path);
+
+		size_t record_count = 0;
+		bool valid = false;
+		{
+			MemoryMappedFile index_file(index_path);
+			IndexHeader header;
+			std::memcpy(&header, index_file.data(), sizeof(header));
+			valid = (std::memcmp(header.magic, magic, sizeof(magic)) == 0) && (header.version == version) && (header.record_size == sizeof(IndexRecord));
+
+			if (valid) {
+				record_count = (index_file.size() - sizeof(IndexHeader)) / sizeof(IndexRecord);
+				const char* records = index_file.data() + sizeof(IndexHeader);
+				locations.reserve(record_count);
+				for (size_t i = 0; i < record_count; ++i) {
+					IndexRecord record;
+					std::memcpy(&record, records + i * sizeof(IndexRecord), sizeof(IndexRecord));
+					//Records are appended in pack order, all records following one that points past the end of the pack do as well.
+					if (record.pack_offset + record.size > pack_size) {
+						record_count = i;
+						break;
+					}
+					locations[record.key] = Location{ record.pack_offset, record.size, record.checksum };
+				}
+			}
+		}
+
+		if (!valid) {
+			std::ofstream(index_path, std::ofstream::binary | std::ofstream::trunc);
+			std::ofstream(pack_path, std::ofstream::binary | std::ofstream::trunc);
+			pack_size = 0;
+			return;
+		}
+
+		//Drop records past the end of the pack and a partially written trailing record. New records stay aligned and dropped 
+		//records can't point into payloads that are appended later.
+		const auto complete_size = sizeof(IndexHeader) + record_count * sizeof(IndexRecord);
+		if (complete_size != index_size)
+			std::filesystem::resize_file(index_path, complete_size);
+	}
+
+	bool PersistentResourceCache::contains(const Key& key) const {
+		std::lock_guard<std::mutex> lock(location_mutex);
+		return locations.find(key) != locations.end();
+	}
+
+	size_t PersistentResourceCache::count() const {
+		std::lock_guard<std::mutex> lock(location_mutex);
+		return locations.size();
+	}
+
+	bool PersistentResourceCache::read(const Key& key, char* dst, size_t size) {
+		Location location;
+		{
+			std::lock_guard<std::mutex> lock(location_mutex);
+			auto it = locations.find(key);
+			if (it == locations.end())
+				return false;
+			location = it->second;
+		}
+		if (location.size != size)
+			return false;
+
+		{
+			std::lock_guard<std::mutex> lock(read_mutex);
+			pack_reader.clear();
+			pack_reader.seekg(location.pack_offset);
+			pack_reader.read(dst, size);
+			if (!pack_reader.good())
+				return false;
+		}
+
+		if (payloadChecksum(dst, size) != location.checksum) {
+			std::lock_guard<std::mutex> lock(location_mutex);
+			locations.erase(key);
+			return false;
+		}
+		return true;
+	}
+
+	void PersistentResourceCache::insert(const Key& key, const char* data, size_t size) {
+		//Checked under the write lock, concurrent inserts of the same key append the payload only once.
+		std::lock_guard<std::mutex> write_lock(write_mutex);
+		{
+			std::lock_guard<std::mutex> lock(location_mutex);
+			if (locations.find(key) != locations.end()) {
+				pending.erase(key);
+				return;
+			}
+		}
+
+		const Location location{ pack_size, static_cast<uint32_t>(size), payloadChecksum(data, size) };
+
+		//The payload has to be on disk before the record that points to it.
+		pack_writer.write(data, size);
+		pack_writer.flush();
+		pack_size += size;
+
+		IndexRecord record{ key, location.pack_offset, location.size, location.checksum };
+		index_writer.write(reinterpret_cast<const char*>(&record), sizeof(record));
+		index_writer.flush();
+
+		std::lock_guard<std::mutex> lock(location_mutex);
+		locations[key] = location;
+		pending.erase(key);
+	}
+
+	void PersistentResourceCache::insertAsync(const std::shared_ptr<PersistentResourceCache>& cache, ThreadPool& pool, const Key& key, std::shared_ptr<const std::vector<char>> payload) {
+		{
+			std::lock_guard<std::mutex> lock(cache->location_mutex);
+			if ((cache->locations.find(key) != cache->locations.end()) || !cache->pending.insert(key).second)
+				return;
+		}
+
+		pool.submit([cache, key, payload]() {
+			cache->insert(key, payload->data(), payload->size());
+		});
+	}
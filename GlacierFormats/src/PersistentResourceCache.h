@@ -0,0 +1,96 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <cinttypes>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace GlacierFormats {
+
+	class ThreadPool;
+
+	//On-disk cache of decompressed resource payloads that survives between runs. Payloads are appended to a single pack file,
+	//the index file holds one fixed size record per payload and is memory mapped when the cache is opened.
+	//Both files are append-only. Records that point past the end of the pack file are dropped on open, so an interrupted
+	//run can't corrupt the cache. Payloads that don't match the checksum of their record are dropped on read.
+	//A cache directory must only be used by one process at a time.
+	class PersistentResourceCache {
+	public:
+		struct Key {
+			uint64_t runtime_id;
+			uint64_t archive;	//ArchiveIndex::identity, stable between runs as long as the archive file is unchanged.
+			uint64_t offset;	//Offset of the resource data inside the archive.
+
+			bool operator==(const Key& other) const noexcept;
+		};
+
+	private:
+#pragma pack(push, 1)
+		struct IndexHeader {
+			char magic[4];
+			uint32_t version;
+			uint32_t record_size;
+		};
+
+		struct IndexRecord {
+			Key key;
+			uint64_t pack_offset;
+			uint32_t size;
+			uint64_t checksum;
+		};
+#pragma pack(pop)
+
+		struct Location {
+			uint64_t pack_offset;
+			uint32_t size;
+			uint64_t checksum;
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const noexcept;
+		};
+
+		static constexpr char magic[4] = { 'G', 'F', 'P', 'C' };
+		static constexpr uint32_t version = 2;
+
+		const std::filesystem::path pack_path;
+		const std::filesystem::path index_path;
+
+		mutable std::mutex location_mutex;
+		std::unordered_map<Key, Location, KeyHash> locations;
+		std::unordered_set<Key, KeyHash> pending;		//Keys queued by insertAsync
+
+		std::mutex write_mutex;
+		std::ofstream pack_writer;
+		std::ofstream index_writer;
+		uint64_t pack_size;
+
+		std::mutex read_mutex;
+		std::ifstream pack_reader;
+
+		void loadIndex();
+
+	public:
+		//Opens or creates the cache files in directory.
+		explicit PersistentResourceCache(const std::filesystem::path& directory);
+		PersistentResourceCache(const PersistentResourceCache&) = delete;
+		PersistentResourceCache& operator=(const PersistentResourceCache&) = delete;
+
+		[[nodiscard]] bool contains(const Key& key) const;
+		size_t count() const;
+
+		//Reads the payload of key into dst. Returns false if the key isn't cached or the cached payload size differs from size.
+		//Payloads that fail their checksum return false and are dropped, a later insert caches them again.
+		bool read(const Key& key, char* dst, size_t size);
+
+		//Appends the payload to the cache. Keys that are already cached are ignored.
+		void insert(const Key& key, const char* data, size_t size);
+
+		//Queues insert on the pool and returns immediately. Used to populate the cache in the background during cold runs.
+		static void insertAsync(const std::shared_ptr<PersistentResourceCache>& cache, ThreadPool& pool, const Key& key, std::shared_ptr<const std::vector<char>> payload);
+	};
+
+}
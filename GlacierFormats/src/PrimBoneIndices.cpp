@@ -4,8 +4,10 @@
 
 using namespace GlacierFormats;
 
-	BoneIndices::BoneIndices(BinaryReader* br) {
-		data_size = br->read<uint32_t>() - 2;
+	template<typename Reader>
+	BoneIndices::BoneIndices(Reader* br) {
+		data_size = br->template read<uint32_t>() - 2;
+		br->validateExtent(static_cast<int64_t>(data_size) * sizeof(uint16_t));
 		data = std::make_unique<uint16_t[]>(data_size);
 		br->read(data.get(), data_size);
 	}
@@ -13,4 +15,7 @@ using namespace GlacierFormats;
 	void BoneIndices::serialize(BinaryWriter* bw) {
 		bw->write(data_size + 2);
 		bw->write(data.get(), data_size);
-	}
\ No newline at end of file
+	}
+
+template BoneIndices::BoneIndices(BinaryReader* br);
+template BoneIndices::BoneIndices(SpanBinaryReader* br);
@@ -15,7 +15,8 @@ namespace GlacierFormats {
 		std::unique_ptr<uint16_t[]> data;
 
 	public:
-		BoneIndices(BinaryReader* br);
+		template<typename Reader>
+		BoneIndices(Reader* br);
 		void serialize(BinaryWriter* bw);
 	};
 
@@ -4,8 +4,9 @@
 
 using namespace GlacierFormats;
 
-	BoneInfo::BoneInfo(BinaryReader* br) {
-		auto size = br->peek<uint16_t>();
+	template<typename Reader>
+	BoneInfo::BoneInfo(Reader* br) {
+		auto size = br->template peek<uint16_t>();
 		data.resize(size);
 		br->read(data.data(), size);
 	}
@@ -15,3 +16,5 @@ using namespace GlacierFormats;
 		bw->write(data.data(), data.size());
 	};
 
+template BoneInfo::BoneInfo(BinaryReader* br);
+template BoneInfo::BoneInfo(SpanBinaryReader* br);
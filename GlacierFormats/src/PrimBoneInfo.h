@@ -16,7 +16,8 @@ namespace GlacierFormats {
 		std::vector<uint8_t> data;
 
 	public:
-		BoneInfo(BinaryReader* br);
+		template<typename Reader>
+		BoneInfo(Reader* br);
 		void serialize(BinaryWriter* bw) const;
 	};
 
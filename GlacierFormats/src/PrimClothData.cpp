@@ -30,11 +30,12 @@ ClothDataType guessSizeType(BinaryReader* br, int vertex_count, int size_hint) {
 	return ClothDataType::LARGE;
 }
 
-ClothData::ClothData(BinaryReader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh) {
+template<typename Reader>
+ClothData::ClothData(Reader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh) {
 
 	bool is_small_buffer = (((int)prim_mesh->cloth_flags & (int)SPrimMesh::CLOTH_FLAGS::USE_SMOLL_CLOTH_BLOCK)) == (int)SPrimMesh::CLOTH_FLAGS::USE_SMOLL_CLOTH_BLOCK;
 	if (is_small_buffer)
-		data.resize(br->peek<uint16_t>());
+		data.resize(br->template peek<uint16_t>());
 	else
 		data.resize(0x14 * prim_submesh->num_vertex);
 	br->read(data.data(), data.size());
@@ -43,4 +44,11 @@ ClothData::ClothData(BinaryReader* br, const SPrimSubMesh* prim_submesh, const S
 
 void ClothData::serialize(BinaryWriter* bw) {
 	bw->write(data.data(), data.size());
-}
\ No newline at end of file
+}
+
+bool ClothData::operator==(const ClothData& other) const {
+	return data == other.data;
+}
+
+template ClothData::ClothData(BinaryReader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh);
+template ClothData::ClothData(SpanBinaryReader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh);
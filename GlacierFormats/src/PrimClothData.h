@@ -14,8 +14,11 @@ namespace GlacierFormats {
 		std::vector<char> data;
 
 	public:
-		ClothData(BinaryReader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh);
+		template<typename Reader>
+		ClothData(Reader* br, const SPrimSubMesh* prim_submesh, const SPrimMesh* prim_mesh);
 		void serialize(BinaryWriter* bw);
+
+		bool operator==(const ClothData& other) const;
 	};
 
 }
@@ -5,8 +5,9 @@
 
 using namespace GlacierFormats;
 
-	CollisionData::CollisionData(BinaryReader* br, CollisionType type) : type(type) {
-		auto size = br->peek<uint16_t>();
+	template<typename Reader>
+	CollisionData::CollisionData(Reader* br, CollisionType type) : type(type) {
+		auto size = br->template peek<uint16_t>();
 #pragma warning(suppress: 6287)
 		if(type == CollisionType::STANDARD || type == CollisionType::WEIGHTED)
 			size = 6 * size + 4;
@@ -27,6 +28,13 @@ using namespace GlacierFormats;
 		bw->align();
 	}
 
+	bool CollisionData::operator==(const CollisionData& other) const {
+		return type == other.type && data == other.data;
+	}
+
 	RecordKey CollisionData::recordKey() const	{
 		return RecordKey({typeid(CollisionData), hash::fnv1a(data)});
 	}
+
+template CollisionData::CollisionData(BinaryReader* br, CollisionType type);
+template CollisionData::CollisionData(SpanBinaryReader* br, CollisionType type);
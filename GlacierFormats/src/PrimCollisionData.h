@@ -22,9 +22,12 @@ namespace GlacierFormats {
 		std::vector<char> data;
 		CollisionType type;
 			
-		CollisionData(BinaryReader* br, CollisionType type);
+		template<typename Reader>
+		CollisionData(Reader* br, CollisionType type);
 		void serialize(BinaryWriter* bw) const;
 
+		bool operator==(const CollisionData& other) const;
+
 		RecordKey recordKey() const override final;
 	};
 
@@ -2,10 +2,14 @@
 #include "BinaryReader.hpp"
 #include "BinaryWriter.hpp"
 
-GlacierFormats::CopyBones::CopyBones(BinaryReader* br, int count) {
+template<typename Reader>
+GlacierFormats::CopyBones::CopyBones(Reader* br, int count) {
+	if (count < 0)
+		throw InvalidArgumentsException("Negative copy bone count");
+	br->validateExtent(2 * static_cast<int64_t>(count) * sizeof(int));
 	copy_bones.resize(2 * count);
 	for (auto& copy_bone : copy_bones)
-		copy_bone = br->read<int>();
+		copy_bone = br->template read<int>();
 	br->align();
 }
 
@@ -18,3 +22,6 @@ void GlacierFormats::CopyBones::serialize(BinaryWriter* bw) const {
 		bw->write(copy_bone);
 	bw->align();
 }
+
+template GlacierFormats::CopyBones::CopyBones(GlacierFormats::BinaryReader* br, int count);
+template GlacierFormats::CopyBones::CopyBones(GlacierFormats::SpanBinaryReader* br, int count);
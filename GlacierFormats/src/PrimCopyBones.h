@@ -11,7 +11,8 @@ namespace GlacierFormats {
 		std::vector<int> copy_bones;
 
 	public:
-		CopyBones(BinaryReader* br, int count);
+		template<typename Reader>
+		CopyBones(Reader* br, int count);
 
 		int copyBoneCount() const;
 
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace GlacierFormats {
+
+	//Controls when and how the vertex streams of parsed primitives are decoded.
+	//Eager decodes all streams during parsing. 
+	//Lazy keeps the packed buffers and decodes each stream when it's first accessed, which is much cheaper for tools that 
+	//only inspect metadata, e.g. material ids, lods or vertex and index counts.
+	//Compact only keeps the packed buffers, i.e. int16 or float3 positions, 8-bit tangent frames and 8-bit weights, and the
+	//IMesh getters decode them on every access without caching the result. Meant for holding many meshes in memory. 
+	//Buffers are converted to the decoded layout once they are modified. Buffer accessors that return references into the
+	//decoded data, e.g. VertexDataBuffer::normalBuffer, decode into the cache and promote the buffer to a cached one.
+	enum class PrimDecodeMode {
+		Eager,
+		Lazy,
+		Compact
+	};
+
+}
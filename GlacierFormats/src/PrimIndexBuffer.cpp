@@ -10,7 +10,11 @@ using namespace GlacierFormats;
 	IndexBuffer::IndexBuffer(const std::vector<uint16_t>& indices) : indices(indices) {
 	}
 
-	IndexBuffer::IndexBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh) {
+	IndexBuffer::IndexBuffer(std::vector<uint16_t>&& indices) : indices(std::move(indices)) {
+	}
+
+	template<typename Reader>
+	IndexBuffer::IndexBuffer(Reader* br, const SPrimSubMesh* prim_submesh) {
 		auto num_indices = prim_submesh->num_indices + prim_submesh->num_indices_ex;
 		indices.resize(num_indices);
 		br->read(indices.data(), indices.size());
@@ -44,7 +48,18 @@ using namespace GlacierFormats;
 		return indices[idx];
 	}
 
+	const uint16_t* IndexBuffer::data() const {
+		return indices.data();
+	}
+
+	bool IndexBuffer::operator==(const IndexBuffer& other) const {
+		return indices == other.indices;
+	}
+
 	RecordKey GlacierFormats::IndexBuffer::recordKey() const {
 		return RecordKey{ typeid(IndexBuffer), hash::fnv1a(indices) };
 	}
 
+template IndexBuffer::IndexBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh);
+template IndexBuffer::IndexBuffer(SpanBinaryReader* br, const SPrimSubMesh* prim_submesh);
+template IndexBuffer::IndexBuffer(UncheckedSpanBinaryReader* br, const SPrimSubMesh* prim_submesh);
@@ -19,7 +19,9 @@ namespace GlacierFormats {
 
 	public:
 		IndexBuffer(const std::vector<uint16_t>& indices);
-		IndexBuffer(BinaryReader* br, const SPrimSubMesh* prim_submesh);
+		IndexBuffer(std::vector<uint16_t>&& indices);
+		template<typename Reader>
+		IndexBuffer(Reader* br, const SPrimSubMesh* prim_submesh);
 
 		void serialize(BinaryWriter* bw) const;
 
@@ -30,6 +32,9 @@ namespace GlacierFormats {
 		std::vector<uint16_t>::iterator end();
 
 		uint16_t& operator[](uint32_t idx);
+		const uint16_t* data() const;
+
+		bool operator==(const IndexBuffer& other) const;
 
 		RecordKey recordKey() const override final;
 	};
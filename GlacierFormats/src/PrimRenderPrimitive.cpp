@@ -10,6 +10,25 @@
 
 using namespace GlacierFormats;
 
+namespace {
+
+	//Replaces a buffer that is shared with other primitives by a copy, so it can be modified.
+	template<typename T>
+	void detach(std::shared_ptr<T>& buffer) {
+		if (buffer && buffer.use_count() > 1)
+			buffer = std::make_shared<T>(*buffer);
+	}
+
+	//Buffers are equal if they are shared, both absent or serialize identically.
+	template<typename Ptr>
+	bool sameBuffer(const Ptr& buffer, const Ptr& other) {
+		if (buffer == other)
+			return true;
+		return buffer && other && *buffer == *other;
+	}
+
+}
+
 	ZRenderPrimitive::ZRenderPrimitive() {
 
 	}
@@ -27,21 +46,43 @@ using namespace GlacierFormats;
 		bone_indices = std::move(src.bone_indices);
 	}
 
-	uint32_t ZRenderPrimitive::serialize(BinaryWriter* bw, std::unordered_map<RecordKey, uint64_t>& buffer_record) const {
+	uint32_t ZRenderPrimitive::serialize(BinaryWriter* bw, RecordTable& records) const {
 		RenderPrimitiveSerializer serializer;
-		return serializer.serialize(bw, this, buffer_record);
+		return serializer.serialize(bw, this, records);
 	}
 
 	bool ZRenderPrimitive::isWeightedMesh() const {
 		return bone_weight_buffer != nullptr;
 	}
 
+	bool ZRenderPrimitive::vertexStreamsEqual(const ZRenderPrimitive& other) const {
+		if (vertex_buffer->size() != other.vertex_buffer->size() || remnant.submesh_properties != other.remnant.submesh_properties)
+			return false;
+
+		return sameBuffer(vertex_buffer, other.vertex_buffer) &&
+			sameBuffer(bone_weight_buffer, other.bone_weight_buffer) &&
+			sameBuffer(vertex_data, other.vertex_data) &&
+			sameBuffer(vertex_colors, other.vertex_colors);
+	}
+
+	bool ZRenderPrimitive::submeshEquals(const ZRenderPrimitive& other) const {
+		//Cheap checks first, most primitives of a PRIM differ in their vertex count.
+		if (index_buffer->size() != other.index_buffer->size() || remnant.submesh_color1 != other.remnant.submesh_color1)
+			return false;
+
+		return vertexStreamsEqual(other) &&
+			sameBuffer(index_buffer, other.index_buffer) &&
+			sameBuffer(collision_data, other.collision_data) &&
+			sameBuffer(cloth_data, other.cloth_data);
+	}
+
 
 	[[nodiscard]] std::string ZRenderPrimitive::name() const noexcept {
 		//TODO: Replace this with a real hash function or an actual name
 		//TODO: Experiments show that some submeshes share the same vertex_buffer => same hash. Not good!
 		size_t hash = 0;
-		for (const auto& v : *vertex_buffer)
+		std::vector<Vertex> scratch;
+		for (const auto& v : vertex_buffer->decodedVertices(scratch))
 			for (const auto& c : v)
 				hash ^= std::hash<float>{}(c);
 
@@ -97,12 +138,32 @@ using namespace GlacierFormats;
 		return bone_weight_buffer->getCanonicalForm();
 	}
 
+	StridedArrayView<float> ZRenderPrimitive::vertexBufferView(std::vector<float>& scratch) const {
+		return vertex_buffer->getCanonicalView(scratch);
+	}
+
+	ArrayView<unsigned short> ZRenderPrimitive::indexBufferView(std::vector<unsigned short>& scratch) const {
+		return ArrayView<unsigned short>(index_buffer->data(), index_buffer->size());
+	}
+
+	StridedArrayView<float> ZRenderPrimitive::normalsView(std::vector<float>& scratch) const {
+		return vertex_data->getNormalsView(scratch);
+	}
+
+	StridedArrayView<float> ZRenderPrimitive::tangentsView(std::vector<float>& scratch) const {
+		return vertex_data->getTangentsView(scratch);
+	}
+
 	void ZRenderPrimitive::setVertexBuffer(const std::vector<float>& vertex_buffer_) {
-		vertex_buffer = std::make_unique<VertexBuffer>(vertex_buffer_);
+		vertex_buffer = std::make_shared<VertexBuffer>(vertex_buffer_);
 	}
 
 	void ZRenderPrimitive::setIndexBuffer(const std::vector<unsigned short>& index_buffer_) {
-		index_buffer = std::make_unique<IndexBuffer>(index_buffer_);
+		index_buffer = std::make_shared<IndexBuffer>(index_buffer_);
+	}
+
+	void ZRenderPrimitive::setIndexBuffer(std::vector<unsigned short>&& index_buffer_) {
+		index_buffer = std::make_shared<IndexBuffer>(std::move(index_buffer_));
 	}
 
 	void ZRenderPrimitive::setNormals(const std::vector<float>& normal_buffer_) {
@@ -111,25 +172,29 @@ using namespace GlacierFormats;
 		//Doesn't seem like it's worth the trouble and performance benefits. 
 		//Refactor this and shift the complexity to (de)serialization.
 		if (!vertex_data)
-			vertex_data = std::make_unique<VertexDataBuffer>();
+			vertex_data = std::make_shared<VertexDataBuffer>();
+		detach(vertex_data);
 		vertex_data->setNormals(normal_buffer_);
 	}
 
 	void GlacierFormats::ZRenderPrimitive::setTangents(const std::vector<float>& tangents_) {
 		if (!vertex_data)
-			vertex_data = std::make_unique<VertexDataBuffer>();
+			vertex_data = std::make_shared<VertexDataBuffer>();
+		detach(vertex_data);
 		vertex_data->setTangents(tangents_);
 	}
 
 	void ZRenderPrimitive::setUVs(const std::vector<float>& uvs) {
 		if (!vertex_data)
-			vertex_data = std::make_unique<VertexDataBuffer>();
+			vertex_data = std::make_shared<VertexDataBuffer>();
+		detach(vertex_data);
 		vertex_data->setUVs(uvs);
 	}
 
 	void ZRenderPrimitive::setBoneWeight(const std::vector<VertexWeight>& weights) {
 		if (!bone_weight_buffer)
-			bone_weight_buffer = std::make_unique<VertexWeightBuffer>();
+			bone_weight_buffer = std::make_shared<VertexWeightBuffer>();
+		detach(bone_weight_buffer);
 		bone_weight_buffer->setFromCanonicalForm(vertex_buffer->size(), weights);
 	}
 
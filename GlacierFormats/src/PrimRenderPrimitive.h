@@ -39,12 +39,14 @@ namespace GlacierFormats {
 			int submesh_color1 = 0;
 		} remnant;
 
-		std::unique_ptr<VertexBuffer> vertex_buffer;
-		std::unique_ptr<IndexBuffer> index_buffer;
-		std::unique_ptr<VertexDataBuffer> vertex_data;
-		std::unique_ptr<VertexWeightBuffer> bone_weight_buffer;
-		std::unique_ptr<VertexColors> vertex_colors;
-		std::unique_ptr<CollisionData> collision_data;
+		//Buffers can be shared with other primitives of the same PRIM if the serialized submeshes reference the same data.
+		//The IMesh setters copy shared buffers before modifying them.
+		std::shared_ptr<VertexBuffer> vertex_buffer;
+		std::shared_ptr<IndexBuffer> index_buffer;
+		std::shared_ptr<VertexDataBuffer> vertex_data;
+		std::shared_ptr<VertexWeightBuffer> bone_weight_buffer;
+		std::shared_ptr<VertexColors> vertex_colors;
+		std::shared_ptr<CollisionData> collision_data;
 		std::unique_ptr<ClothData> cloth_data;
 		std::unique_ptr<CopyBones> copy_bones;
 		std::unique_ptr<BoneInfo> bone_info;
@@ -52,10 +54,15 @@ namespace GlacierFormats {
 
 		ZRenderPrimitive(ZRenderPrimitive&&);
 
-		uint32_t serialize(BinaryWriter* bw, std::unordered_map<RecordKey, uint64_t>& ) const;
+		uint32_t serialize(BinaryWriter* bw, RecordTable& records) const;
 
 		[[nodiscard]] bool isWeightedMesh() const;
 
+		//Primitives with equal vertex streams share a single serialized vertex block.
+		[[nodiscard]] bool vertexStreamsEqual(const ZRenderPrimitive& other) const;
+		//Primitives with equal submeshes are serialized with a single submesh that is referenced by all of their meshes.
+		[[nodiscard]] bool submeshEquals(const ZRenderPrimitive& other) const;
+
 		//IMesh interface functions
 		[[nodiscard]] std::string name() const noexcept override final;
 		[[nodiscard]] int materialId() const noexcept override final;
@@ -67,8 +74,21 @@ namespace GlacierFormats {
 		[[nodiscard]] std::vector<float> getUVs() const override final;
 		[[nodiscard]] std::vector<IMesh::VertexWeight> getBoneWeights() const override final;
 
+		//Positions and normals are viewed with the padding of the decoded float4 streams, uvs and bone weights are converted.
+		//Buffers parsed with PrimDecodeMode::Compact are always converted.
+		[[nodiscard]] StridedArrayView<float> vertexBufferView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] ArrayView<unsigned short> indexBufferView(std::vector<unsigned short>& scratch) const override final;
+		[[nodiscard]] StridedArrayView<float> normalsView(std::vector<float>& scratch) const override final;
+		[[nodiscard]] StridedArrayView<float> tangentsView(std::vector<float>& scratch) const override final;
+
+		using IMesh::setVertexBuffer;
+		using IMesh::setNormals;
+		using IMesh::setTangents;
+		using IMesh::setUVs;
+		using IMesh::setBoneWeight;
 		void setVertexBuffer(const std::vector<float>&) override final;
 		void setIndexBuffer(const std::vector<unsigned short>&) override final;
+		void setIndexBuffer(std::vector<unsigned short>&&) override final;
 		void setNormals(const std::vector<float>&) override final;
 		void setTangents(const std::vector<float>&) override final;
 		void setUVs(const std::vector<float>&) override final;
@@ -16,7 +16,7 @@ using namespace GlacierFormats;
 			throw std::runtime_error("RenderMesh validation failed: Per vertex data read_buffer missing");
 
 		const auto vertex_count = prim->vertexCount();
-		if ((prim->vertex_data->normals.size() != vertex_count) || (prim->vertex_data->uvs.size() != vertex_count))
+		if ((prim->vertex_data->normalBuffer().size() != vertex_count) || (prim->vertex_data->uvBuffer().size() != vertex_count))
 			throw std::runtime_error("RenderMesh validation failed: Invalid per vertex data read_buffer size");
 
 	}
@@ -3,13 +3,72 @@
 #include "BinaryReader.hpp"
 #include "BinaryWriter.hpp"
 #include "Exceptions.h"
-#include "Hash.h"
 #include "IntegerRangeCompression.h"
+#include <cstring>
+#include <algorithm>
 
 using namespace GlacierFormats;
 
-	uint32_t RenderPrimitiveSerializer::serialize(BinaryWriter* bw, const ZRenderPrimitive* prim, std::unordered_map<RecordKey, uint64_t>& buffer_record) {
-		RecordKey record_key{ typeid(void), 0};
+namespace {
+
+	//Serialized size of the index buffer of a submesh.
+	int64_t indexBufferSize(const SPrimSubMesh& prim_submesh) {
+		if (prim_submesh.num_indices < 0 || prim_submesh.num_indices_ex < 0)
+			throw InvalidArgumentsException("Negative index count");
+		return (static_cast<int64_t>(prim_submesh.num_indices) + prim_submesh.num_indices_ex) * sizeof(uint16_t);
+	}
+
+	//Serialized size of the consecutive per vertex streams of a submesh: positions, weights, vertex data and colors.
+	int64_t vertexStreamSize(const SPrimObjectHeader& prim_object_header, const SPrimMesh& prim_mesh, const SPrimSubMesh& prim_submesh) {
+		if (prim_submesh.num_vertex < 0)
+			throw InvalidArgumentsException("Negative vertex count");
+
+		const bool is_high_res = ((int)prim_object_header.property_flags & (int)SPrimObjectHeader::PROPERTY_FLAGS::HAS_HIRES_POSITIONS) != 0;
+		const bool is_weighted = prim_mesh.sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED;
+		const bool has_colors = is_weighted || ((int)prim_submesh.properties & (int)SPrimObject::PROPERTY_FLAGS::PROPERTY_COLOR1) == 0;
+
+		int64_t vertex_size = is_high_res ? 3 * sizeof(float) : 4 * sizeof(short);
+		if (is_weighted)
+			vertex_size += 2 * VertexWeights::size;
+		vertex_size += 0x10;
+		if (has_colors)
+			vertex_size += 4;
+
+		return vertex_size * prim_submesh.num_vertex;
+	}
+
+	//Submeshes can only share decoded vertex streams if they were encoded with the same parameters.
+	bool sameVertexStreamParameters(const SPrimMesh& mesh0, const SPrimSubMesh& submesh0, const SPrimMesh& mesh1, const SPrimSubMesh& submesh1) {
+		return submesh0.num_vertex == submesh1.num_vertex &&
+			submesh0.properties == submesh1.properties &&
+			mesh0.sub_type == mesh1.sub_type &&
+			std::memcmp(mesh0.pos_scale, mesh1.pos_scale, sizeof(mesh0.pos_scale)) == 0 &&
+			std::memcmp(mesh0.pos_bias, mesh1.pos_bias, sizeof(mesh0.pos_bias)) == 0 &&
+			std::memcmp(mesh0.uv_scale, mesh1.uv_scale, sizeof(mesh0.uv_scale)) == 0 &&
+			std::memcmp(mesh0.uv_bias, mesh1.uv_bias, sizeof(mesh0.uv_bias)) == 0;
+	}
+
+}
+
+template<typename T>
+std::pair<uint64_t, bool> RenderPrimitiveSerializer::findRecord(const T* buffer, RecordTable& records, uint64_t offset) {
+	auto [record, inserted] = records.buffers.try_emplace(buffer, offset);
+	if (!inserted)
+		return { record->second, false };
+
+	const auto key = buffer->recordKey();
+	auto [equal_begin, equal_end] = records.buffer_contents.equal_range(key);
+	for (auto it = equal_begin; it != equal_end; ++it) {
+		if (*static_cast<const T*>(it->second) == *buffer) {
+			record->second = records.buffers.at(it->second);
+			return { record->second, false };
+		}
+	}
+	records.buffer_contents.emplace(key, buffer);
+	return { offset, true };
+}
+
+	uint32_t RenderPrimitiveSerializer::serializeSubmesh(BinaryWriter* bw, const ZRenderPrimitive* prim, const BoundingBox<Vertex>& vertex_buffer_bb, RecordTable& records) {
 
 		SPrimSubMesh submesh{};
 		submesh.color1 = prim->remnant.submesh_color1;
@@ -26,12 +85,10 @@ using namespace GlacierFormats;
 		//Not sure about weighted.
 		//Collision
 		if (prim->collision_data) {
-			record_key = prim->collision_data->recordKey();
-			if (buffer_record.find(record_key) == buffer_record.end()) {
-				buffer_record[record_key] = bw->tell();
+			auto [collision_offset, inserted] = findRecord(prim->collision_data.get(), records, bw->tell());
+			if (inserted)
 				prim->collision_data->serialize(bw);
-			}
-			submesh.collision = buffer_record[record_key];
+			submesh.collision = collision_offset;
 		}
 		else {
 			submesh.collision = 0;
@@ -39,20 +96,30 @@ using namespace GlacierFormats;
 		bw->align();
 
 		//Index Buffer
-		record_key = prim->index_buffer->recordKey();
-		if (buffer_record.find(record_key) == buffer_record.end()) {
-			buffer_record[record_key] = bw->tell();
+		auto [index_offset, index_inserted] = findRecord(prim->index_buffer.get(), records, bw->tell());
+		if (index_inserted)
 			prim->index_buffer->serialize(bw);
-		}
-		submesh.index_buffer = buffer_record[record_key];
+		submesh.index_buffer = index_offset;
 		submesh.num_indices = prim->index_buffer->size();
 		
 		//Per vertex data
-		record_key = prim->vertex_buffer->recordKey();
-		if (buffer_record.find(record_key) == buffer_record.end()) {
+		const std::array<const void*, 4> vertex_streams{ prim->vertex_buffer.get(), prim->bone_weight_buffer.get(), prim->vertex_data.get(), prim->vertex_colors.get() };
+		auto [vertex_record, vertex_inserted] = records.vertex_streams.try_emplace(vertex_streams, bw->tell());
+		if (vertex_inserted) {
+			const auto key = prim->vertex_buffer->recordKey();
+			auto [equal_begin, equal_end] = records.vertex_stream_contents.equal_range(key);
+			const auto equal = std::find_if(equal_begin, equal_end, [prim](const auto& record) { return record.second->vertexStreamsEqual(*prim); });
+			if (equal != equal_end) {
+				vertex_inserted = false;
+				vertex_record->second = records.vertex_streams.at(std::array<const void*, 4>{ equal->second->vertex_buffer.get(), equal->second->bone_weight_buffer.get(), equal->second->vertex_data.get(), equal->second->vertex_colors.get() });
+			}
+			else {
+				records.vertex_stream_contents.emplace(key, prim);
+			}
+		}
+		if (vertex_inserted) {
 
 			//Vertex Buffer
-			buffer_record[record_key] = bw->tell();
 			prim->vertex_buffer->serialize(bw);
 
 			//Vertex Weights
@@ -73,9 +140,8 @@ using namespace GlacierFormats;
 				}
 			}
 		}
-		submesh.vertex_buffer = buffer_record[record_key];
+		submesh.vertex_buffer = vertex_record->second;
 		submesh.num_vertex = prim->vertex_buffer->size();
-		BoundingBox vertex_buffer_bb = prim->vertex_buffer->getBoundingBox();
 		for (int i = 0; i < 3; ++i) {
 			submesh.min[i] = vertex_buffer_bb.min[i];
 			submesh.max[i] = vertex_buffer_bb.max[i];
@@ -92,32 +158,34 @@ using namespace GlacierFormats;
 		}
 		bw->align();
 
-		//if (prim->collision_data) {
-		//	record_key = prim->collision_data->recordKey();
-		//	if (buffer_record.find(record_key) == buffer_record.end()) {
-		//		buffer_record[record_key] = bw->tell();
-		//		prim->collision_data->serialize(bw);
-		//	}
-		//	submesh.collision = buffer_record[record_key];
-		//}
-		//else {
-		//	submesh.collision = 0;
-		//}
 
-		bw->align();
+		uint32_t submesh_offset = static_cast<uint32_t>(bw->tell());
+		submesh.Assert();
+		bw->write(submesh);
 
-		record_key = RecordKey{ typeid(SPrimSubMesh), hash::fnv1a(submesh) }; //Points to submesh table offset, not to submesh struct
-		if (buffer_record.find(record_key) == buffer_record.end()) {
-			uint32_t submesh_offset = static_cast<uint32_t>(bw->tell());
-			submesh.Assert();
-			bw->write(submesh);
+		//submesh table
+		auto submesh_table_offset = static_cast<uint32_t>(bw->tell());
+		bw->write(submesh_offset);
+		bw->align();
+		return submesh_table_offset;
+	}
 
-			//submesh table
-			buffer_record[record_key] = static_cast<uint32_t>(bw->tell());
-			bw->write(submesh_offset);
-			bw->align();
+	uint32_t RenderPrimitiveSerializer::serialize(BinaryWriter* bw, const ZRenderPrimitive* prim, RecordTable& records) {
+		const auto vertex_buffer_bb = prim->vertex_buffer->getBoundingBox();
+
+		//Primitives that only differ in their mesh records, like LODs and variants of the same geometry, reference the 
+		//submesh table of the first equal submesh instead of serializing it again.
+		uint32_t submesh_table_offset = 0;
+		const auto shared_submesh = std::find_if(records.submeshes.begin(), records.submeshes.end(), [prim](const auto& record) {
+			return record.first->submeshEquals(*prim);
+		});
+		if (shared_submesh != records.submeshes.end()) {
+			submesh_table_offset = shared_submesh->second;
+		}
+		else {
+			submesh_table_offset = serializeSubmesh(bw, prim, vertex_buffer_bb, records);
+			records.submeshes.emplace_back(prim, submesh_table_offset);
 		}
-		auto submesh_table_offset = static_cast<uint32_t>(buffer_record[record_key]);
 
 		SPrimMeshWeighted prim_mesh{};
 		prim_mesh.sub_mesh_table = submesh_table_offset;
@@ -141,9 +209,7 @@ using namespace GlacierFormats;
 		}
 		bw->align();
 
-		vertex_buffer_bb.getIntegerRangeCompressionParameters(prim_mesh.pos_scale, prim_mesh.pos_bias);
-		prim_mesh.pos_scale[3] = 0.5; //The fourth entry in scale and bias has a hard coded value for some reason.
-		prim_mesh.pos_bias[3] = 0.5;
+		prim->vertex_buffer->getCompressionParameters(prim_mesh.pos_scale, prim_mesh.pos_bias);
 
 		for (int i = 0; i < 3; ++i) {
 			prim_mesh.min[i] = vertex_buffer_bb.min[i];
@@ -151,14 +217,7 @@ using namespace GlacierFormats;
 		}
 
 		
-		float texture_scale[2];
-		float texture_bias[2];
-		BoundingBox uv_bb = BoundingBox(prim->vertex_data->uvs);
-		uv_bb.getIntegerRangeCompressionParameters(texture_scale, texture_bias);
-		for (int i = 0; i < 2; ++i) {
-			prim_mesh.uv_scale[i] = texture_scale[i];
-			prim_mesh.uv_bias[i] = texture_bias[i];
-		}
+		prim->vertex_data->getUVCompressionParameters(prim_mesh.uv_scale, prim_mesh.uv_bias);
 
 		prim_mesh.type = SPrimObjectHeader::EPrimType::PTMESH;
 
@@ -183,16 +242,41 @@ using namespace GlacierFormats;
 		return object_offset;
 	}
 
-std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(BinaryReader* br, const SPrimObjectHeader* const prim_object_header) {
+template<typename Key, typename T>
+std::shared_ptr<RenderPrimitiveDeserializer::SharedRecord<T>> RenderPrimitiveDeserializer::findRecord(std::map<Key, std::shared_ptr<SharedRecord<T>>>& records, const Key& key) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	auto& record = records[key];
+	if (!record)
+		record = std::make_shared<SharedRecord<T>>();
+	return record;
+}
+
+std::shared_ptr<RenderPrimitiveDeserializer::VertexStreams> RenderPrimitiveDeserializer::findVertexStreams(const SPrimMesh& prim_mesh, const SPrimSubMesh& prim_submesh) {
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	auto [shared_begin, shared_end] = vertex_streams.equal_range(prim_submesh.vertex_buffer);
+	for (auto it = shared_begin; it != shared_end; ++it) {
+		if (sameVertexStreamParameters(it->second->prim_mesh, it->second->prim_submesh, prim_mesh, prim_submesh))
+			return it->second;
+	}
+
+	auto streams = std::make_shared<VertexStreams>();
+	streams->prim_mesh = prim_mesh;
+	streams->prim_submesh = prim_submesh;
+	vertex_streams.emplace(prim_submesh.vertex_buffer, streams);
+	return streams;
+}
+
+template<typename Reader>
+std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(Reader* br, const SPrimObjectHeader* const prim_object_header, PrimDecodeMode mode) {
 	std::unique_ptr<SPrimMesh> prim_mesh = nullptr;
-	switch (br->peek<SPrimMesh>().sub_type) {
+	switch (br->template peek<SPrimMesh>().sub_type) {
 	case SPrimObject::SUBTYPE::SUBTYPE_STANDARD:
-		prim_mesh = std::make_unique<SPrimMesh>(br->read<SPrimMesh>());
+		prim_mesh = std::make_unique<SPrimMesh>(br->template read<SPrimMesh>());
 		prim_mesh->Assert();
 		break;
 	case SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED:
 	case SPrimObject::SUBTYPE::SUBTYPE_LINKED:
-		prim_mesh = std::make_unique<SPrimMeshWeighted>(br->read<SPrimMeshWeighted>());
+		prim_mesh = std::make_unique<SPrimMeshWeighted>(br->template read<SPrimMeshWeighted>());
 		static_cast<SPrimMeshWeighted*>(prim_mesh.get())->Assert();
 		break;
 	default:
@@ -201,11 +285,11 @@ std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(B
 	br->align();
 
 	br->seek(prim_mesh->sub_mesh_table);
-	auto submesh_offset = br->read<uint32_t>();
+	auto submesh_offset = br->template read<uint32_t>();
 	br->align();
 
 	br->seek(submesh_offset);
-	auto prim_submesh = br->read<SPrimSubMesh>();
+	auto prim_submesh = br->template read<SPrimSubMesh>();
 	prim_submesh.Assert();
 
 	if (prim_submesh.num_uv_channels != 1)
@@ -224,35 +308,45 @@ std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(B
 	prim->remnant.submesh_color1 = prim_submesh.color1;
 
 	//Index buffer
-	br->seek(prim_submesh.index_buffer);
-	prim->index_buffer = std::make_unique<IndexBuffer>(br, &prim_submesh);
-	br->align();
-
-	//Vertex buffer
-	br->seek(prim_submesh.vertex_buffer);
-	prim->vertex_buffer = std::make_unique<VertexBuffer>(br, prim_object_header, prim_mesh.get(), &prim_submesh);
-	auto bb = prim->vertex_buffer->getBoundingBox();
-
-	float scale[3];
-	float bias[3];
-	IntegerRangeCompressor<short, float>::getCompressionParameters(bb.min[0], bb.max[0], scale[0], bias[0]);
-	IntegerRangeCompressor<short, float>::getCompressionParameters(bb.min[1], bb.max[1], scale[1], bias[1]);
-	IntegerRangeCompressor<short, float>::getCompressionParameters(bb.min[2], bb.max[2], scale[2], bias[2]);
-
-
-	//Vertex weights
-	if(prim_mesh->sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED)
-		prim->bone_weight_buffer = std::make_unique<VertexWeightBuffer>(br, &prim_submesh);
-	
-	//Per vertex data (normals, uv, ...)
-	prim->vertex_data = std::make_unique<VertexDataBuffer>(br, prim_mesh.get(), &prim_submesh);
-	
-	//Vertex colors
-	if (prim_mesh->sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED)
-		prim->vertex_colors = std::make_unique<VertexColors>(br, &prim_submesh);
-	else if (((int)prim_submesh.properties & (int)SPrimObject::PROPERTY_FLAGS::PROPERTY_COLOR1) == 0)
-		prim->vertex_colors = std::make_unique<VertexColors>(br, &prim_submesh);
-	br->align();
+	//Counts and offsets are validated once against the buffer, the decoders then run on an unchecked reader when possible.
+	//Buffers that were already decoded for a previous submesh are shared instead of being read again.
+	auto index_record = findRecord(index_buffers, std::make_pair(prim_submesh.index_buffer, indexBufferSize(prim_submesh)));
+	std::call_once(index_record->decoded, [&]() {
+		br->seek(prim_submesh.index_buffer);
+		readValidated(*br, indexBufferSize(prim_submesh), [&](auto& vbr) {
+			index_record->buffer = std::make_shared<IndexBuffer>(&vbr, &prim_submesh);
+		});
+		br->align();
+	});
+	prim->index_buffer = index_record->buffer;
+
+	//Per vertex streams
+	auto streams = findVertexStreams(*prim_mesh, prim_submesh);
+	std::call_once(streams->decoded, [&]() {
+		br->seek(prim_submesh.vertex_buffer);
+		readValidated(*br, vertexStreamSize(*prim_object_header, *prim_mesh, prim_submesh), [&](auto& vbr) {
+			//Vertex buffer
+			streams->vertex_buffer = std::make_shared<VertexBuffer>(&vbr, prim_object_header, prim_mesh.get(), &prim_submesh, mode);
+
+			//Vertex weights
+			if (prim_mesh->sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED)
+				streams->bone_weight_buffer = std::make_shared<VertexWeightBuffer>(&vbr, &prim_submesh, mode);
+
+			//Per vertex data (normals, uv, ...)
+			streams->vertex_data = std::make_shared<VertexDataBuffer>(&vbr, prim_mesh.get(), &prim_submesh, mode);
+
+			//Vertex colors
+			if (prim_mesh->sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED)
+				streams->vertex_colors = std::make_shared<VertexColors>(&vbr, &prim_submesh);
+			else if (((int)prim_submesh.properties & (int)SPrimObject::PROPERTY_FLAGS::PROPERTY_COLOR1) == 0)
+				streams->vertex_colors = std::make_shared<VertexColors>(&vbr, &prim_submesh);
+		});
+		br->align();
+	});
+	prim->vertex_buffer = streams->vertex_buffer;
+	prim->bone_weight_buffer = streams->bone_weight_buffer;
+	prim->vertex_data = streams->vertex_data;
+	prim->vertex_colors = streams->vertex_colors;
 
 	//Cloth
 	if (prim_submesh.cloth) {
@@ -262,16 +356,13 @@ std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(B
 
 	//Collision
 	if (prim_submesh.collision) {
-		br->seek(prim_submesh.collision);
-		switch (prim_mesh->sub_type) {
-		case SPrimObject::SUBTYPE::SUBTYPE_STANDARD:
-		case SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED:
-				prim->collision_data = std::make_unique<CollisionData>(br, CollisionType::STANDARD);
-				break;
-		case SPrimObject::SUBTYPE::SUBTYPE_LINKED:
-				prim->collision_data = std::make_unique<CollisionData>(br, CollisionType::LINKED);
-				break;
-		}
+		const auto collision_type = prim_mesh->sub_type == SPrimObject::SUBTYPE::SUBTYPE_LINKED ? CollisionType::LINKED : CollisionType::STANDARD;
+		auto collision = findRecord(collision_data, std::make_pair(prim_submesh.collision, static_cast<int>(collision_type)));
+		std::call_once(collision->decoded, [&]() {
+			br->seek(prim_submesh.collision);
+			collision->buffer = std::make_shared<CollisionData>(br, collision_type);
+		});
+		prim->collision_data = collision->buffer;
 	}
 	br->align();
 
@@ -302,4 +393,7 @@ std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(B
 	br->align();
 
 	return prim;
-}
\ No newline at end of file
+}
+
+template std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(BinaryReader* br, const SPrimObjectHeader* const prim_object_header, PrimDecodeMode mode);
+template std::unique_ptr<ZRenderPrimitive> RenderPrimitiveDeserializer::deserializeMesh(SpanBinaryReader* br, const SPrimObjectHeader* const prim_object_header, PrimDecodeMode mode);
@@ -1,23 +1,76 @@
 #pragma once
 #include <cinttypes>
 #include <memory>
+#include <unordered_map>
+#include <map>
+#include <mutex>
 #include "PrimSerializationTypes.h"
 #include "PrimReusableRecord.h"
+#include "PrimDecodeMode.h"
+#include "PrimBoundingBox.h"
 
 namespace GlacierFormats {
 
-	class BinaryReader;
 	class BinaryWriter;
 	class ZRenderPrimitive;
+	class VertexBuffer;
+	class IndexBuffer;
+	class VertexDataBuffer;
+	class VertexWeightBuffer;
+	class VertexColors;
+	class CollisionData;
 
 	class RenderPrimitiveSerializer {
+		//Returns the offset of a written buffer that is the same object as or equal to buffer. Otherwise buffer is recorded
+		//at offset and has to be written by the caller, indicated by the second member.
+		template<typename T>
+		std::pair<uint64_t, bool> findRecord(const T* buffer, RecordTable& records, uint64_t offset);
+
+		//Serializes the submesh of prim and returns the offset of its submesh table.
+		uint32_t serializeSubmesh(BinaryWriter* bw, const ZRenderPrimitive* prim, const BoundingBox<Vec<float, 4>>& vertex_buffer_bb, RecordTable& records);
+
 	public:
-		uint32_t serialize(BinaryWriter* br, const ZRenderPrimitive* prim, std::unordered_map<RecordKey, uint64_t>&);
+		uint32_t serialize(BinaryWriter* br, const ZRenderPrimitive* prim, RecordTable& records);
 	};
 
+	//Deserializes the primitives of a single PRIM. Buffers are cached by file offset, submeshes that reference the 
+	//same buffer share a single decoded instance. Use one deserializer per PRIM. deserializeMesh can be called 
+	//concurrently with one reader per thread, a buffer that is referenced by several submeshes is still only decoded once.
 	class RenderPrimitiveDeserializer {
+	private:
+		//Cache entry that is decoded by the first submesh that references it. Other submeshes wait for that decode.
+		template<typename T>
+		struct SharedRecord {
+			std::once_flag decoded;
+			std::shared_ptr<T> buffer;
+		};
+
+		struct VertexStreams {
+			SPrimMesh prim_mesh;
+			SPrimSubMesh prim_submesh;
+			std::once_flag decoded;
+			std::shared_ptr<VertexBuffer> vertex_buffer;
+			std::shared_ptr<VertexWeightBuffer> bone_weight_buffer;
+			std::shared_ptr<VertexDataBuffer> vertex_data;
+			std::shared_ptr<VertexColors> vertex_colors;
+		};
+
+		std::mutex cache_mutex;
+		//Keyed by offset and index count.
+		std::map<std::pair<int, int64_t>, std::shared_ptr<SharedRecord<IndexBuffer>>> index_buffers;
+		std::unordered_multimap<int, std::shared_ptr<VertexStreams>> vertex_streams;
+		//Keyed by offset and collision type.
+		std::map<std::pair<int, int>, std::shared_ptr<SharedRecord<CollisionData>>> collision_data;
+
+		template<typename Key, typename T>
+		std::shared_ptr<SharedRecord<T>> findRecord(std::map<Key, std::shared_ptr<SharedRecord<T>>>& records, const Key& key);
+
+		std::shared_ptr<VertexStreams> findVertexStreams(const SPrimMesh& prim_mesh, const SPrimSubMesh& prim_submesh);
+
 	public:
-		std::unique_ptr<ZRenderPrimitive> deserializeMesh(BinaryReader* br, const SPrimObjectHeader* const prim_object_header);
+		//Lazy and compact deserialization only copy the packed vertex streams, see PrimDecodeMode.
+		template<typename Reader>
+		std::unique_ptr<ZRenderPrimitive> deserializeMesh(Reader* br, const SPrimObjectHeader* const prim_object_header, PrimDecodeMode mode = PrimDecodeMode::Eager);
 	};
 
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 #include <typeindex>
 #include <functional>
+#include <unordered_map>
+#include <array>
+#include <map>
+#include <vector>
+#include <utility>
 
 namespace GlacierFormats {
 
@@ -18,3 +23,25 @@ struct std::hash<GlacierFormats::RecordKey> {
 		return pair.first.hash_code() ^ pair.second;
 	}
 };
+
+
+namespace GlacierFormats {
+
+	class ZRenderPrimitive;
+
+	//Offsets of records that were already written during PRIM serialization. Buffers are identified by address first, 
+	//buffers that are shared between primitives are therefore written once and referenced by all of them without hashing
+	//their content. Separately built buffers are found through their record key and compared by content. Submeshes are 
+	//identified by content, see ZRenderPrimitive::submeshEquals.
+	struct RecordTable {
+		std::unordered_map<const void*, uint64_t> buffers;
+		std::unordered_multimap<RecordKey, const void*> buffer_contents;
+		//Per vertex streams are serialized back to back and can only be reused if all of them are shared or equal.
+		//Equal streams are keyed by the record key of their vertex buffer.
+		std::map<std::array<const void*, 4>, uint64_t> vertex_streams;
+		std::unordered_multimap<RecordKey, const ZRenderPrimitive*> vertex_stream_contents;
+		//Serialized primitives and the offsets of their submesh tables.
+		std::vector<std::pair<const ZRenderPrimitive*, uint32_t>> submeshes;
+	};
+
+}
@@ -1,17 +1,20 @@
 #include <vector>
+#include <algorithm>
+#include <limits>
 #include "PrimVertexBuffer.h"
 #include "PrimSerializationTypes.h"
 #include "BinaryReader.hpp"
 #include "BinaryWriter.hpp"
 #include "Hash.h"
 #include "IntegerRangeCompression.h"
+#include "VertexCodec.h"
 
 using namespace GlacierFormats;
 
 	VertexBuffer::VertexBuffer(const std::vector<float>& positions) {
 		is_high_res_buffer = false;
 		const int floats_per_vert = 3;
-		auto vertex_count = positions.size() / floats_per_vert;
+		vertex_count = positions.size() / floats_per_vert;
 
 		vertices.reserve(vertex_count);
 		for (int i = 0; i < positions.size(); i += floats_per_vert) {
@@ -19,66 +22,160 @@ using namespace GlacierFormats;
 		}
 	}
 
-	VertexBuffer::VertexBuffer(BinaryReader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh) {
+	template<typename Reader>
+	VertexBuffer::VertexBuffer(Reader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode) {
 		is_high_res_buffer = (
 			((int)prim_object_header->property_flags & (int)SPrimObjectHeader::PROPERTY_FLAGS::HAS_HIRES_POSITIONS) == 
 			(int)SPrimObjectHeader::PROPERTY_FLAGS::HAS_HIRES_POSITIONS
 			);
+		vertex_count = prim_submesh->num_vertex;
+		for (int i = 0; i < 4; ++i) {
+			pos_scale[i] = prim_mesh->pos_scale[i];
+			pos_bias[i] = prim_mesh->pos_bias[i];
+		}
+
+		packed.resize(packedSize());
+		br->read(packed.data(), packed.size());
+		compact = mode == PrimDecodeMode::Compact;
+		if (mode == PrimDecodeMode::Eager)
+			decode();
+	}
 
+	size_t VertexBuffer::packedSize() const noexcept {
+		return vertex_count * (is_high_res_buffer ? sizeof(Vec<float, 3>) : 4 * sizeof(int16_t));
+	}
+
+	void VertexBuffer::decodeInto(std::vector<Vertex>& out) const {
+		UncheckedSpanBinaryReader br(UncheckedBinaryReaderSpanSource(packed.data(), packed.size()));
+		out.resize(vertex_count);
 		if (!is_high_res_buffer) {
-			vertices.resize(prim_submesh->num_vertex);
-			for (int i = 0; i < prim_submesh->num_vertex; ++i) {
-				//There is an off-by-one error in IOI's compression code. The compressed shorts only range from -32767 to 32767.
-
-				vertices[i].x() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->pos_scale[0], prim_mesh->pos_bias[0]);
-				vertices[i].y() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->pos_scale[1], prim_mesh->pos_bias[1]);
-				vertices[i].z() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->pos_scale[2], prim_mesh->pos_bias[2]);
-				vertices[i].w() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->pos_scale[3], prim_mesh->pos_bias[3]);
-			}
+			//There is an off-by-one error in IOI's compression code. The compressed shorts only range from -32767 to 32767.
+			static_assert(sizeof(Vertex) == 4 * sizeof(float));
+			std::vector<int16_t> scratch;
+			const auto compressed = br.readArray<int16_t>(4 * out.size(), scratch);
+			VertexCodec::decodePositions(compressed.data(), reinterpret_cast<float*>(out.data()), out.size(), pos_scale, pos_bias);
 		}
 		else {
-			vertices.resize(prim_submesh->num_vertex);
-			for (int i = 0; i < prim_submesh->num_vertex; ++i) {
-				vertices[i].x() = br->read<float>();
-				vertices[i].y() = br->read<float>();
-				vertices[i].z() = br->read<float>();
+			br.decodeInto<Vec<float, 3>>(out.data(), out.size(), [](const Vec<float, 3>& packed) {
+				Vertex vertex;
+				vertex.x() = packed.x();
+				vertex.y() = packed.y();
+				vertex.z() = packed.z();
+				return vertex;
+			});
+		}
+	}
+
+	void VertexBuffer::decode() const {
+		std::call_once(decode_flag, [this]() {
+			if (packed.empty())
+				return;
+			decodeInto(vertices);
+			cached.store(true, std::memory_order_release);
+		});
+	}
+
+	const std::vector<Vertex>& VertexBuffer::decodedVertices(std::vector<Vertex>& scratch) const {
+		if (decodesOnAccess()) {
+			decodeInto(scratch);
+			return scratch;
+		}
+
+		decode();
+		return vertices;
+	}
+
+	bool VertexBuffer::decodesOnAccess() const noexcept {
+		return compact && !packed.empty() && !cached.load(std::memory_order_acquire);
+	}
+
+	void VertexBuffer::markModified() {
+		decode();
+		packed = std::vector<char>();
+	}
+
+	//Bounding box of the decoded vertices computed from the packed vertices. Decompression is monotonic, so
+	//decompressing the extreme compressed values yields the same bounds as decoding all vertices.
+	BoundingBox<Vertex> VertexBuffer::getPackedBoundingBox() const {
+		BoundingBox<Vertex> bb;
+		if (!vertex_count)
+			return bb;
+
+		int16_t min[4];
+		int16_t max[4];
+		std::fill(std::begin(min), std::end(min), std::numeric_limits<int16_t>::max());
+		std::fill(std::begin(max), std::end(max), std::numeric_limits<int16_t>::min());
+
+		std::vector<int16_t> scratch;
+		UncheckedSpanBinaryReader br(UncheckedBinaryReaderSpanSource(packed.data(), packed.size()));
+		const auto compressed = br.readArray<int16_t>(4 * vertex_count, scratch);
+		for (size_t i = 0; i < compressed.size(); i += 4) {
+			for (int j = 0; j < 4; ++j) {
+				min[j] = std::min(min[j], compressed[i + j]);
+				max[j] = std::max(max[j], compressed[i + j]);
 			}
 		}
+
+		for (int j = 0; j < 4; ++j) {
+			const auto lo = IntegerRangeCompressor<short, float>::decompress(min[j], pos_scale[j], pos_bias[j]);
+			const auto hi = IntegerRangeCompressor<short, float>::decompress(max[j], pos_scale[j], pos_bias[j]);
+			bb.min[j] = std::min(bb.min[j], std::min(lo, hi));
+			bb.max[j] = std::max(bb.max[j], std::max(lo, hi));
+		}
+		return bb;
 	}
 
 	std::vector<float> VertexBuffer::getCanonicalForm() const
 	{
+		std::vector<Vertex> scratch;
+		const auto& decoded = decodedVertices(scratch);
 		constexpr int canonical_vertex_size = 3;
 
 		std::vector<float> ret;
-		ret.reserve(canonical_vertex_size * vertices.size());
-		for (const auto& vert : vertices)
+		ret.reserve(canonical_vertex_size * decoded.size());
+		for (const auto& vert : decoded)
 			for (int i = 0; i < canonical_vertex_size; ++i)
 				ret.push_back(vert[i]);
 
 		return ret;
 	}
 
+	StridedArrayView<float> VertexBuffer::getCanonicalView(std::vector<float>& scratch) const {
+		constexpr int canonical_vertex_size = 3;
+		if (decodesOnAccess()) {
+			scratch = getCanonicalForm();
+			return StridedArrayView<float>(scratch, canonical_vertex_size);
+		}
+
+		decode();
+		return StridedArrayView<float>(reinterpret_cast<const float*>(vertices.data()), vertices.size(), canonical_vertex_size, Vertex::size());
+	}
+
+	void VertexBuffer::getCompressionParameters(float scale[4], float bias[4]) const {
+		if (!packed.empty()) {
+			std::copy(std::begin(pos_scale), std::end(pos_scale), scale);
+			std::copy(std::begin(pos_bias), std::end(pos_bias), bias);
+			return;
+		}
+
+		getBoundingBox().getIntegerRangeCompressionParameters(scale, bias);
+		scale[3] = 0.5; //The fourth entry in scale and bias has a hard coded value for some reason.
+		bias[3] = 0.5;
+	}
+
 	void VertexBuffer::serialize(BinaryWriter* bw) {
-		if (!is_high_res_buffer) {
+		if (!packed.empty()) {
+			bw->write(packed.data(), packed.size());
+		}
+		else if (!is_high_res_buffer) {
 			float scale[4];
 			float bias[4];
-
-			BoundingBox bb = BoundingBox(vertices);
-			bb.getIntegerRangeCompressionParameters(scale, bias);
+			getCompressionParameters(scale, bias);
 
 			//Only low res serialisation.
-			for (const auto& vertex : vertices) {
-				auto x = IntegerRangeCompressor<short,float>::compress(vertex[0], scale[0], bias[0]);
-				auto y = IntegerRangeCompressor<short,float>::compress(vertex[1], scale[1], bias[1]);
-				auto z = IntegerRangeCompressor<short,float>::compress(vertex[2], scale[2], bias[2]);
-				short w = 0x7FFF;
-
-				bw->write(x);
-				bw->write(y);
-				bw->write(z);
-				bw->write(w);
-			}
+			std::vector<int16_t> compressed(4 * vertices.size());
+			VertexCodec::encodePositions(reinterpret_cast<const float*>(vertices.data()), compressed.data(), vertices.size(), scale, bias);
+			bw->write(compressed.data(), compressed.size());
 		}
 		else {
 			for (const auto& vertex : vertices) {
@@ -91,41 +188,75 @@ using namespace GlacierFormats;
 
 	std::vector<Vertex>::iterator VertexBuffer::begin() noexcept
 	{
+		markModified();
 		return vertices.begin();
 	}
 
 	std::vector<Vertex>::iterator VertexBuffer::end() noexcept
 	{
+		markModified();
 		return vertices.end();
 	}
 
 	std::vector<Vertex>::const_iterator VertexBuffer::begin() const noexcept
 	{
+		decode();
 		return vertices.begin();
 	}
 
 	std::vector<Vertex>::const_iterator VertexBuffer::end() const noexcept
 	{
+		decode();
 		return vertices.end();
 	}
 
 	size_t VertexBuffer::size() const noexcept {
-		return vertices.size();
+		return vertex_count;
 	}
 
 	Vertex& VertexBuffer::operator[](uint32_t idx) {
+		markModified();
 		return vertices[idx];
 	}
 
 	const Vertex& VertexBuffer::operator[](uint32_t idx) const {
+		decode();
 		return vertices[idx];
 	}
 
+	const Vertex* VertexBuffer::data() const {
+		decode();
+		return vertices.data();
+	}
+
+	bool VertexBuffer::operator==(const VertexBuffer& other) const {
+		if (vertex_count != other.vertex_count || is_high_res_buffer != other.is_high_res_buffer || packed.empty() != other.packed.empty())
+			return false;
+
+		if (!packed.empty()) {
+			return std::equal(std::begin(pos_scale), std::end(pos_scale), std::begin(other.pos_scale)) &&
+				std::equal(std::begin(pos_bias), std::end(pos_bias), std::begin(other.pos_bias)) &&
+				packed == other.packed;
+		}
+		return vertices == other.vertices;
+	}
+
 	RecordKey VertexBuffer::recordKey() const {
+		if (!packed.empty())
+			return RecordKey{ typeid(VertexBuffer), hash::fnv1a(packed) ^ (31 * hash::fnv1a(pos_scale) + hash::fnv1a(pos_bias)) };
+
+		decode();
 		return RecordKey{ typeid(VertexBuffer), hash::fnv1a(vertices) };
 	}
 
 	BoundingBox<Vertex> VertexBuffer::getBoundingBox() const {
-		return BoundingBox<Vertex>(vertices);
+		if (!packed.empty() && !is_high_res_buffer)
+			return getPackedBoundingBox();
+
+		std::vector<Vertex> scratch;
+		return BoundingBox<Vertex>(decodedVertices(scratch));
 	}
 
+template VertexBuffer::VertexBuffer(BinaryReader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexBuffer::VertexBuffer(SpanBinaryReader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexBuffer::VertexBuffer(UncheckedSpanBinaryReader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
@@ -1,9 +1,13 @@
 #pragma once
 #include <vector>
+#include <mutex>
+#include <atomic>
 #include "Vector.h"
 #include "PrimSerializationTypes.h"
 #include "PrimBoundingBox.h"
 #include "PrimReusableRecord.h"
+#include "PrimDecodeMode.h"
+#include "ArrayView.h"
 
 namespace GlacierFormats {
 
@@ -18,23 +22,54 @@ namespace GlacierFormats {
 	//a integer range compressed set of four signed shorts. The serialized format used
 	//is indicated by the SPrimOnjectHeader::HAS_HIRES_POSITIONS flag. The float represenation
 	//is used if the flag is set.
+	//Buffers read from a resource keep the serialized vertices and compression parameters until they are modified, 
+	//unmodified buffers are written back verbatim. Lazily constructed buffers decode the vertices on first access, compact
+	//buffers decode them on every access through getCanonicalForm, getCanonicalView and decodedVertices. The const 
+	//iterators, operator[] and data return references into the decoded vertices and promote compact buffers to cached ones.
 
 	class VertexBuffer : public ReusableRecord {
 	private:
-		std::vector<Vertex> vertices;
+		mutable std::vector<Vertex> vertices;
+		size_t vertex_count;
 		bool is_high_res_buffer;
 
+		//Serialized vertices and compression parameters as read from the resource. Empty for modified buffers.
+		std::vector<char> packed;
+		float pos_scale[4] = {};
+		float pos_bias[4] = {};
+		mutable std::once_flag decode_flag;
+		//Set once the serialized vertices are decoded into vertices.
+		mutable std::atomic<bool> cached = false;
+		bool compact = false;
+
+		size_t packedSize() const noexcept;
+		//True if the vertices are decoded into scratch on every access instead of being cached.
+		bool decodesOnAccess() const noexcept;
+		void decodeInto(std::vector<Vertex>& out) const;
+		void decode() const;
+		void markModified();
+		BoundingBox<Vertex> getPackedBoundingBox() const;
+
 	public:
 		VertexBuffer(const std::vector<float>& positions);
-		VertexBuffer(BinaryReader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh);
+		template<typename Reader>
+		VertexBuffer(Reader* br, const SPrimObjectHeader* prim_object_header, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode = PrimDecodeMode::Eager);
 
 		[[nodiscard]] std::vector<float> getCanonicalForm() const;
+		//Strided view of the decoded positions. Compact buffers decode into scratch instead, see IMesh::vertexBufferView.
+		[[nodiscard]] StridedArrayView<float> getCanonicalView(std::vector<float>& scratch) const;
+		//Returns the decoded vertices. Compact buffers decode into scratch instead of caching the vertices.
+		const std::vector<Vertex>& decodedVertices(std::vector<Vertex>& scratch) const;
 
 		BoundingBox<Vertex> getBoundingBox() const;
 
+		//Integer range compression parameters used to serialize the buffer. Unmodified buffers return the original parameters.
+		void getCompressionParameters(float scale[4], float bias[4]) const;
+
 		void serialize(BinaryWriter* br);
 
 		size_t size() const noexcept;
+		//Mutable access marks the buffer as modified.
 		std::vector<Vertex>::iterator begin() noexcept;
 		std::vector<Vertex>::iterator end() noexcept;
 		std::vector<Vertex>::const_iterator begin() const noexcept;
@@ -42,6 +77,11 @@ namespace GlacierFormats {
 
 		Vertex& operator[](uint32_t idx);
 		const Vertex& operator[](uint32_t idx) const;
+		const Vertex* data() const;
+
+		//Buffers are equal if they serialize identically. Unmodified buffers are compared by their serialized vertices and
+		//compression parameters and are never equal to modified ones.
+		bool operator==(const VertexBuffer& other) const;
 
 		RecordKey recordKey() const override final;
 	};
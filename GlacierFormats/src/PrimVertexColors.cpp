@@ -8,7 +8,8 @@ using namespace GlacierFormats;
 		colors = std::vector<unsigned char>(4* vertex_count, 0xFF);
 	}
 
-	VertexColors::VertexColors(BinaryReader* br, const SPrimSubMesh* prim_submesh) {
+	template<typename Reader>
+	VertexColors::VertexColors(Reader* br, const SPrimSubMesh* prim_submesh) {
 		auto size = 4 * prim_submesh->num_vertex;
 		colors.resize(size);
 		br->read(colors.data(), size);
@@ -17,3 +18,11 @@ using namespace GlacierFormats;
 	void VertexColors::serialize(BinaryWriter* bw) const {
 		bw->write(colors.data(), colors.size());
 	};
+
+	bool VertexColors::operator==(const VertexColors& other) const {
+		return colors == other.colors;
+	}
+
+template VertexColors::VertexColors(BinaryReader* br, const SPrimSubMesh* prim_submesh);
+template VertexColors::VertexColors(SpanBinaryReader* br, const SPrimSubMesh* prim_submesh);
+template VertexColors::VertexColors(UncheckedSpanBinaryReader* br, const SPrimSubMesh* prim_submesh);
@@ -13,7 +13,10 @@ namespace GlacierFormats {
 		std::vector<unsigned char> colors;
 
 		explicit VertexColors(int size) noexcept;
-		VertexColors(BinaryReader* br, const SPrimSubMesh* prim_submesh);
+		template<typename Reader>
+		VertexColors(Reader* br, const SPrimSubMesh* prim_submesh);
 		void serialize(BinaryWriter* bw) const;
+
+		bool operator==(const VertexColors& other) const;
 	};
 }
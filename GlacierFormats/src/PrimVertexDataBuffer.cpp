@@ -4,17 +4,28 @@
 #include "PrimBoundingBox.h"
 #include "Util.h"
 #include "IntegerRangeCompression.h"
+#include "VertexCodec.h"
+#include <algorithm>
 
 using namespace GlacierFormats;
 
 namespace {
 
+	//Serialized layout of a single vertex in the vertex data buffer.
+	struct PackedVertexData {
+		uint8_t normal[4];
+		uint8_t tangent[4];
+		uint8_t bitangent[4];
+		short uv[2];
+	};
+	static_assert(sizeof(PackedVertexData) == VertexCodec::vertex_data_record_size);
+
 	inline float Decompress8BitFloat(uint8_t b) {
-		return 2.0f * static_cast<float>(b) / 255.0f - 1.0f;
+		return VertexCodec::decompress8BitFloat(b);
 	}
 
 	inline uint8_t Compress8BitFloat(float f) {
-		return static_cast<uint8_t>(std::round((f + 1.0) / 2.0 * 255.0));
+		return VertexCodec::compress8BitFloat(f);
 	}
 
 	[[noreturn]] void PerfectReserializationExperiment(BinaryReader* br, int vertex_count) {
@@ -55,110 +66,192 @@ namespace {
 	VertexDataBuffer::VertexDataBuffer() {
 	}
 
-	VertexDataBuffer::VertexDataBuffer(BinaryReader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh) {
-		normals.resize(prim_submesh->num_vertex);
-		tangents.resize(prim_submesh->num_vertex);
-		bitangents.resize(prim_submesh->num_vertex);
-		uvs.resize(prim_submesh->num_vertex);
+	template<typename V>
+	const std::vector<V>& VertexDataBuffer::decodedStream(std::vector<V> VertexDataBuffer::* stream, std::vector<V>& scratch) const {
+		if (!decodesOnAccess()) {
+			decode();
+			return this->*stream;
+		}
+
+		scratch.resize(vertex_count);
+		auto* out = reinterpret_cast<float*>(scratch.data());
+		const auto* records = reinterpret_cast<const uint8_t*>(packed.data());
+		if constexpr (std::is_same_v<V, UV>) {
+			VertexCodec::decodeVertexData(records, vertex_count, nullptr, nullptr, nullptr, out, uv_scale, uv_bias);
+		}
+		else {
+			VertexCodec::decodeVertexData(records, vertex_count,
+				stream == &VertexDataBuffer::normals ? out : nullptr,
+				stream == &VertexDataBuffer::tangents ? out : nullptr,
+				stream == &VertexDataBuffer::bitangents ? out : nullptr,
+				nullptr, uv_scale, uv_bias);
+		}
+		return scratch;
+	}
+
+	VertexDataBuffer::VertexDataBuffer(const VertexDataBuffer& other) : packed(other.packed), vertex_count(other.vertex_count), compact(other.compact) {
+		std::copy(std::begin(other.uv_scale), std::end(other.uv_scale), uv_scale);
+		std::copy(std::begin(other.uv_bias), std::end(other.uv_bias), uv_bias);
+
+		//Copies of compact buffers stay compact.
+		if (other.decodesOnAccess())
+			return;
+
+		other.decode();
+		normals = other.normals;
+		tangents = other.tangents;
+		bitangents = other.bitangents;
+		uvs = other.uvs;
+		//The streams are copied decoded.
+		std::call_once(decode_flag, []() {});
+		cached = true;
+	}
+
+	template<typename Reader>
+	VertexDataBuffer::VertexDataBuffer(Reader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode) {
+		vertex_count = prim_submesh->num_vertex;
+		for (int i = 0; i < 2; ++i) {
+			uv_scale[i] = prim_mesh->uv_scale[i];
+			uv_bias[i] = prim_mesh->uv_bias[i];
+		}
 
 		//PerfectReserializationExperiment(br, prim_submesh->num_vertex);
 		//Experiment(br, prim_submesh->num_vertex);
 
-		for (size_t i = 0; i < prim_submesh->num_vertex; ++i) {
-			//TODO: Read complete blocks for performance
+		packed.resize(vertex_count * sizeof(PackedVertexData));
+		br->read(packed.data(), packed.size());
+		compact = mode == PrimDecodeMode::Compact;
+		if (mode == PrimDecodeMode::Eager)
+			decode();
+	}
+
+	void VertexDataBuffer::decodeInto(std::vector<Normal>& normals_out, std::vector<Tangent>& tangents_out, std::vector<Bitangent>& bitangents_out, std::vector<UV>& uvs_out) const {
+		normals_out.resize(vertex_count);
+		tangents_out.resize(vertex_count);
+		bitangents_out.resize(vertex_count);
+		uvs_out.resize(vertex_count);
+
+		//TODO: Consider switching to Vec<float, 3> normals, 4th term likely always .0f. Do scan of full repo to confirm. Would simplify mesh import a bit.
+		static_assert(sizeof(Vec<float, 4>) == 4 * sizeof(float) && sizeof(UV) == 2 * sizeof(float));
+		VertexCodec::decodeVertexData(reinterpret_cast<const uint8_t*>(packed.data()), vertex_count,
+			reinterpret_cast<float*>(normals_out.data()), reinterpret_cast<float*>(tangents_out.data()), reinterpret_cast<float*>(bitangents_out.data()), reinterpret_cast<float*>(uvs_out.data()),
+			uv_scale, uv_bias);
+	}
 
-			//Normal
-			//TODO: Consider switching to Vec<float, 3> normals, 4th term likely always .0f. Do scan of full repo to confirm. Would simplify mesh import a bit.
-			normals[i].x() = Decompress8BitFloat(br->read<uint8_t>());
-			normals[i].y() = Decompress8BitFloat(br->read<uint8_t>());
-			normals[i].z() = Decompress8BitFloat(br->read<uint8_t>());
-			normals[i].w() = Decompress8BitFloat(br->read<uint8_t>());
+	void VertexDataBuffer::decode() const {
+		std::call_once(decode_flag, [this]() {
+			if (packed.empty())
+				return;
+			decodeInto(normals, tangents, bitangents, uvs);
+			cached.store(true, std::memory_order_release);
+		});
+	}
 
-			tangents[i].x() = Decompress8BitFloat(br->read<uint8_t>());
-			tangents[i].y() = Decompress8BitFloat(br->read<uint8_t>());
-			tangents[i].z() = Decompress8BitFloat(br->read<uint8_t>());
-			tangents[i].w() = Decompress8BitFloat(br->read<uint8_t>());
+	bool VertexDataBuffer::decodesOnAccess() const noexcept {
+		return compact && !packed.empty() && !cached.load(std::memory_order_acquire);
+	}
 
-			bitangents[i].x() = Decompress8BitFloat(br->read<uint8_t>());
-			bitangents[i].y() = Decompress8BitFloat(br->read<uint8_t>());
-			bitangents[i].z() = Decompress8BitFloat(br->read<uint8_t>());
-			bitangents[i].w() = Decompress8BitFloat(br->read<uint8_t>());
+	void VertexDataBuffer::markModified() {
+		//Pending records are decoded first, otherwise a later decode would overwrite the modified streams.
+		decode();
+		packed = std::vector<char>();
+	}
 
-			uvs[i].x() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->uv_scale[0], prim_mesh->uv_bias[0]);
-			uvs[i].y() = IntegerRangeCompressor<short, float>::decompress(br->read<short>(), prim_mesh->uv_scale[1], prim_mesh->uv_bias[1]);
+	void VertexDataBuffer::getUVCompressionParameters(float scale[2], float bias[2]) const {
+		if (!packed.empty()) {
+			std::copy(std::begin(uv_scale), std::end(uv_scale), scale);
+			std::copy(std::begin(uv_bias), std::end(uv_bias), bias);
+			return;
 		}
+
+		BoundingBox bb = BoundingBox(uvs);
+		bb.getIntegerRangeCompressionParameters(scale, bias);
 	}
 
 	void VertexDataBuffer::serialize(BinaryWriter* bw) {
-		//calc uv scale and bias
-		float uv_scale[2];
-		float uv_bias[2];
-		BoundingBox bb = BoundingBox(uvs);
-		bb.getIntegerRangeCompressionParameters(uv_scale, uv_bias);
+		if (!packed.empty()) {
+			bw->write(packed.data(), packed.size());
+			return;
+		}
+
+		float scale[2];
+		float bias[2];
+		getUVCompressionParameters(scale, bias);
+
+		GLACIER_ASSERT_TRUE(tangents.size() == normals.size() && uvs.size() == normals.size());
+		GLACIER_ASSERT_TRUE(bitangents.empty() || bitangents.size() == normals.size());
 
-		for (size_t i = 0; i < normals.size(); ++i) {
+		//Bitangents that weren't set explicitly are derived from the normals and tangents.
+		std::vector<Vec<float, 4>> derived_bitangents;
+		if (!bitangents.size()) {
+			derived_bitangents.resize(normals.size());
+			for (size_t i = 0; i < normals.size(); ++i) {
+				const auto bitangent = cross(normals[i].xyz(), tangents[i].xyz());
+				derived_bitangents[i] = Vec<float, 4>(bitangent.x(), bitangent.y(), bitangent.z(), 0.f);
+			}
+		}
+		const auto& out_bitangents = bitangents.size() ? bitangents : derived_bitangents;
 
-			const auto& normal = normals[i];
-			const auto& tangent = tangents[i];
+		std::vector<PackedVertexData> records(normals.size());
+		VertexCodec::encodeVertexData(reinterpret_cast<const float*>(normals.data()), reinterpret_cast<const float*>(tangents.data()), reinterpret_cast<const float*>(out_bitangents.data()), reinterpret_cast<const float*>(uvs.data()),
+			normals.size(), reinterpret_cast<uint8_t*>(records.data()), scale, bias);
+		bw->write(records.data(), records.size());
+	}
 
-			bw->write(Compress8BitFloat(normal.x()));
-			bw->write(Compress8BitFloat(normal.y()));
-			bw->write(Compress8BitFloat(normal.z()));
-			bw->write(Compress8BitFloat(normal.w()));
+	const std::vector<Normal>& VertexDataBuffer::normalBuffer() const {
+		decode();
+		return normals;
+	}
 
-			
-			bw->write(Compress8BitFloat(tangent.x()));
-			bw->write(Compress8BitFloat(tangent.y()));
-			bw->write(Compress8BitFloat(tangent.z()));
-			bw->write(Compress8BitFloat(tangent.w()));
+	const std::vector<Tangent>& VertexDataBuffer::tangentBuffer() const {
+		decode();
+		return tangents;
+	}
 
-			if (bitangents.size()) {
-				bw->write(Compress8BitFloat(bitangents[i].x()));
-				bw->write(Compress8BitFloat(bitangents[i].y()));
-				bw->write(Compress8BitFloat(bitangents[i].z()));
-				bw->write(Compress8BitFloat(0.f));
-			}
-			else {
-				auto bitangent = cross(normal.xyz(), tangent.xyz());
-				bw->write(Compress8BitFloat(bitangent.x()));
-				bw->write(Compress8BitFloat(bitangent.y()));
-				bw->write(Compress8BitFloat(bitangent.z()));
-				bw->write(Compress8BitFloat(0.f));
-			}
+	const std::vector<Bitangent>& VertexDataBuffer::bitangentBuffer() const {
+		decode();
+		return bitangents;
+	}
 
-			bw->write(IntegerRangeCompressor<short, float>::compress(uvs[i].x(), uv_scale[0], uv_bias[0]));
-			bw->write(IntegerRangeCompressor<short, float>::compress(uvs[i].y(), uv_scale[1], uv_bias[1]));
-		}
+	const std::vector<UV>& VertexDataBuffer::uvBuffer() const {
+		decode();
+		return uvs;
 	}
 
 	std::vector<float> VertexDataBuffer::getNormals() const
 	{
+		std::vector<Normal> scratch;
+		const auto& decoded = decodedStream(&VertexDataBuffer::normals, scratch);
 		constexpr int canonical_normal_size = 3;
 
 		std::vector<float> ret;
-		ret.reserve(canonical_normal_size * normals.size());
-		for (const auto& normal : normals)
+		ret.reserve(canonical_normal_size * decoded.size());
+		for (const auto& normal : decoded)
 			for (int i = 0; i < canonical_normal_size; ++i)
 				ret.push_back(normal[i]);
 		return ret;
 	}
 
 	std::vector<float> GlacierFormats::VertexDataBuffer::getTangents() const {
+		std::vector<Tangent> scratch;
+		const auto& decoded = decodedStream(&VertexDataBuffer::tangents, scratch);
 		std::vector<float> ret;
 
 		const int tangent_size = 4;
-		auto f_cnt = tangents.size() * tangent_size;
+		auto f_cnt = decoded.size() * tangent_size;
 		ret.resize(f_cnt);
-		memcpy_s(ret.data(), f_cnt * sizeof(float), tangents.data(), f_cnt * sizeof(float));
+		memcpy_s(ret.data(), f_cnt * sizeof(float), decoded.data(), f_cnt * sizeof(float));
 		return ret;
 	}
 
 	std::vector<float> VertexDataBuffer::getUVs() const
 	{
+		std::vector<UV> scratch;
+		const auto& decoded = decodedStream(&VertexDataBuffer::uvs, scratch);
 		constexpr int canonical_uv_size = 2;
 		static_assert(sizeof(UV) == canonical_uv_size * sizeof(float));
-		std::vector<float> ret(canonical_uv_size * uvs.size());
-		memcpy_s(ret.data(), sizeof(decltype(ret)::value_type) * ret.size(), uvs.data(), uvs.size() * sizeof(decltype(uvs)::value_type));
+		std::vector<float> ret(canonical_uv_size * decoded.size());
+		memcpy_s(ret.data(), sizeof(float) * ret.size(), decoded.data(), decoded.size() * sizeof(UV));
 
 		//invert y coord;
 		for (int i = 1; i < ret.size(); i += 2)
@@ -166,7 +259,30 @@ namespace {
 		return ret;
 	}
 
+	StridedArrayView<float> VertexDataBuffer::getNormalsView(std::vector<float>& scratch) const {
+		constexpr int canonical_normal_size = 3;
+		if (decodesOnAccess()) {
+			scratch = getNormals();
+			return StridedArrayView<float>(scratch, canonical_normal_size);
+		}
+
+		decode();
+		return StridedArrayView<float>(reinterpret_cast<const float*>(normals.data()), normals.size(), canonical_normal_size, Normal::size());
+	}
+
+	StridedArrayView<float> VertexDataBuffer::getTangentsView(std::vector<float>& scratch) const {
+		constexpr int canonical_tangent_size = 4;
+		if (decodesOnAccess()) {
+			scratch = getTangents();
+			return StridedArrayView<float>(scratch, canonical_tangent_size);
+		}
+
+		decode();
+		return StridedArrayView<float>(reinterpret_cast<const float*>(tangents.data()), tangents.size(), canonical_tangent_size, Tangent::size());
+	}
+
 	void VertexDataBuffer::setNormals(const std::vector<float>& normal_buffer) {
+		markModified();
 		const int normal_size = 3;
 		auto normal_count = normal_buffer.size() / normal_size;
 
@@ -182,6 +298,7 @@ namespace {
 	
 	//Set tangents from vector of floats. 4 floats per tangent.
 	void VertexDataBuffer::setTangents(const std::vector<float>& tangent_buffer) {
+		markModified();
 		const int tangent_size = 4;
 		auto tangent_count = tangent_buffer.size() / tangent_size;
 
@@ -191,6 +308,7 @@ namespace {
 	}
 
 	void VertexDataBuffer::setUVs(const std::vector<float>& uv_buffer) {
+		markModified();
 		const int uv_size = 2;
 		auto uv_count = uv_buffer.size() / uv_size;
 
@@ -199,3 +317,19 @@ namespace {
 		memcpy_s(uvs.data(), vectorSizeInBytes(uvs), uv_buffer.data(), vectorSizeInBytes(uv_buffer));
 	}
 
+	bool VertexDataBuffer::operator==(const VertexDataBuffer& other) const {
+		if (packed.empty() != other.packed.empty())
+			return false;
+
+		if (!packed.empty()) {
+			return vertex_count == other.vertex_count &&
+				std::equal(std::begin(uv_scale), std::end(uv_scale), std::begin(other.uv_scale)) &&
+				std::equal(std::begin(uv_bias), std::end(uv_bias), std::begin(other.uv_bias)) &&
+				packed == other.packed;
+		}
+		return normals == other.normals && tangents == other.tangents && bitangents == other.bitangents && uvs == other.uvs;
+	}
+
+template VertexDataBuffer::VertexDataBuffer(BinaryReader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexDataBuffer::VertexDataBuffer(SpanBinaryReader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
+template VertexDataBuffer::VertexDataBuffer(UncheckedSpanBinaryReader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode);
@@ -1,7 +1,11 @@
 #pragma once
 #include <vector>
+#include <mutex>
+#include <atomic>
 #include "Vector.h"
 #include "PrimSerializationTypes.h"
+#include "PrimDecodeMode.h"
+#include "ArrayView.h"
 
 namespace GlacierFormats {
 
@@ -13,24 +17,68 @@ namespace GlacierFormats {
 	using Bitangent = Vec<float, 4>;
 	using UV = Vec<float, 2>;
 
+	//Holds the per vertex normals, tangents, bitangents and uvs. Buffers read from a resource keep the serialized records
+	//until they are modified, unmodified buffers are written back verbatim. Lazily constructed buffers decode the records
+	//on first access, compact buffers decode the requested stream on every access through the getters and views. The 
+	//*Buffer accessors return references into the decoded streams and promote compact buffers to cached ones.
 	class VertexDataBuffer
 	{
-	public:
-		std::vector<Normal> normals;
-		std::vector<Tangent> tangents;
-		std::vector<Bitangent> bitangents;
-		std::vector<UV> uvs;
+	private:
+		mutable std::vector<Normal> normals;
+		mutable std::vector<Tangent> tangents;
+		mutable std::vector<Bitangent> bitangents;
+		mutable std::vector<UV> uvs;
+
+		//Serialized records and uv compression parameters as read from the resource. Empty for modified buffers.
+		std::vector<char> packed;
+		size_t vertex_count = 0;
+		float uv_scale[2] = {};
+		float uv_bias[2] = {};
+		mutable std::once_flag decode_flag;
+		//Set once the serialized records are decoded into the streams.
+		mutable std::atomic<bool> cached = false;
+		bool compact = false;
+
+		void decodeInto(std::vector<Normal>& normals_out, std::vector<Tangent>& tangents_out, std::vector<Bitangent>& bitangents_out, std::vector<UV>& uvs_out) const;
+		void decode() const;
+		void markModified();
+
+		//True if the streams are decoded into scratch on every access instead of being cached.
+		bool decodesOnAccess() const noexcept;
+
+		//Returns the decoded stream. Compact buffers only decode that stream into scratch instead of the cached streams.
+		template<typename V>
+		const std::vector<V>& decodedStream(std::vector<V> VertexDataBuffer::* stream, std::vector<V>& scratch) const;
 
+	public:
 		VertexDataBuffer();
-		VertexDataBuffer(BinaryReader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh);
+		VertexDataBuffer(const VertexDataBuffer& other);
+		template<typename Reader>
+		VertexDataBuffer(Reader* br, const SPrimMesh* prim_mesh, const SPrimSubMesh* prim_submesh, PrimDecodeMode mode = PrimDecodeMode::Eager);
 		void serialize(BinaryWriter* bw);
 
+		const std::vector<Normal>& normalBuffer() const;
+		const std::vector<Tangent>& tangentBuffer() const;
+		const std::vector<Bitangent>& bitangentBuffer() const;
+		const std::vector<UV>& uvBuffer() const;
+
+		//Integer range compression parameters used to serialize the uvs. Unmodified buffers return the original parameters.
+		void getUVCompressionParameters(float scale[2], float bias[2]) const;
+
 		std::vector<float> getNormals() const;
 		std::vector<float> getTangents() const;
 		std::vector<float> getUVs() const;
 
+		//Strided views of the decoded normals and tangents. Compact buffers decode into scratch instead, see IMesh::normalsView.
+		StridedArrayView<float> getNormalsView(std::vector<float>& scratch) const;
+		StridedArrayView<float> getTangentsView(std::vector<float>& scratch) const;
+
 		void setNormals(const std::vector<float>&);
 		void setTangents(const std::vector<float>&);
 		void setUVs(const std::vector<float>&);
+
+		//Buffers are equal if they serialize identically. Unmodified buffers are compared by their serialized records and uv
+		//compression parameters and are never equal to modified ones.
+		bool operator==(const VertexDataBuffer& other) const;
 	};
 }
\ No newline at end of file
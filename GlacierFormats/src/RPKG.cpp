@@ -2,6 +2,7 @@
 #include "Rpkg.h"
 #include "BinaryReader.hpp"
 #include "BinaryWriter.hpp"
+#include "BinaryWriterMappedFileSink.hpp"
 #include <cstdint>
 #include <filesystem>
 #include <algorithm>
@@ -41,30 +42,37 @@ using namespace GlacierFormats;
 		return ret;
 	}
 
+	void PkgFile::EntryInfo::PackedSize::decode(EntryInfo& info, const uint32_t& zsize) {
+		info.compressed_size = zsize & 0x3FFFFFFF;
+		info.is_compressed = !(info.compressed_size == 0);
+		info.is_encrypted = (zsize & 0x80000000) != 0;
+	}
+
+	uint32_t PkgFile::EntryInfo::PackedSize::encode(const EntryInfo& info) {
+		return info.compressed_size | (static_cast<int>(info.is_encrypted) << 0x1F);
+	}
+
 	void PkgFile::EntryInfo::read(BinaryReader& br) {
-		runtimeID = br.read<uint64_t>();
-		data_offset = br.read<uint64_t>();
-		uint32_t zsize = br.read<uint32_t>();
-		compressed_size = zsize & 0x3FFFFFFF;
-		is_compressed = !(compressed_size == 0);
-		is_encrypted = (zsize & 0x80000000) != 0;
+		Layout::read(br, *this);
 	}
 
 	void PkgFile::EntryInfo::write(BinaryWriter& bw) const {
-		bw.write(runtimeID);
-		bw.write(data_offset);
+		Layout::write(bw, *this);
+	}
 
-		uint32_t zsize = compressed_size | (static_cast<int>(is_encrypted) << 0x1F);
-		bw.write(zsize);
+	void PkgFile::EntryDescriptor::PackedType::decode(EntryDescriptor& descriptor, const Packed& type) {
+		descriptor.type.assign(type.rbegin(), type.rend());
+	}
+
+	PkgFile::EntryDescriptor::PackedType::Packed PkgFile::EntryDescriptor::PackedType::encode(const EntryDescriptor& descriptor) {
+		GLACIER_ASSERT_TRUE(descriptor.type.size() == TYPE_STR_LEN);
+		Packed type;
+		std::copy(descriptor.type.rbegin(), descriptor.type.rend(), type.begin());
+		return type;
 	}
 
 	void PkgFile::EntryDescriptor::read(BinaryReader& br) {
-		type = br.readString<4, BinaryReader::Endianness::LE>();
-		dependency_descriptor_size = br.read<uint32_t>();
-		chunk_size = br.read<uint32_t>();
-		size = br.read<uint32_t>();
-		mem_size = br.read<uint32_t>();
-		video_mem_size = br.read<uint32_t>();
+		HeaderLayout::read(br, *this);
 		dependency_count = 0;
 		dependency_table_ordering = 0;
 
@@ -100,12 +108,7 @@ using namespace GlacierFormats;
 
 	void PkgFile::EntryDescriptor::write(BinaryWriter& bw) const {
 
-		bw.writeLEString(type);
-		bw.write(dependency_descriptor_size);
-		bw.write(chunk_size);
-		bw.write(size);
-		bw.write(mem_size);
-		bw.write(video_mem_size);
+		HeaderLayout::write(bw, *this);
 
 		if (dependency_descriptor_size > 0) {
 			//The information content of chunk_ds is not well understood, could have more functionality than what's used here.
@@ -185,11 +188,11 @@ using namespace GlacierFormats;
 		insertFile(runtime_id, type, data.data(), data.size(), references);
 	}
 
-	//transfers ownership of data ptr to RPKG
-	void RPKG::insertFile(RuntimeId runtime_id, const std::string& type, const char* data, size_t data_size, const std::vector<ResourceReference>* references) {
+	//Adds an uncompressed, unencrypted file entry without data. Returns nullptr if the archive already contains the runtime id.
+	PkgFile* RPKG::addFile(RuntimeId runtime_id, const std::string& type, size_t data_size, const std::vector<ResourceReference>* references) {
 		auto it = std::find_if(files.begin(), files.end(), [&](const PkgFile& f) {return f.entry_info.runtimeID == runtime_id; });
 		if (it != files.end())
-			return; //TODO: Re-evaluate what the best behaviour is for this case. Import routines of models with materials that reuse textures might trigger this path.
+			return nullptr; //TODO: Re-evaluate what the best behaviour is for this case. Import routines of models with materials that reuse textures might trigger this path.
 
 		PkgFile pkg = PkgFile();
 		pkg.entry_info.is_compressed = false;
@@ -200,8 +203,6 @@ using namespace GlacierFormats;
 		pkg.entry_descriptor.mem_size = data_size;
 		pkg.entry_descriptor.video_mem_size = -1;
 		pkg.entry_descriptor.type = type;
-		pkg.data = std::make_unique<std::vector<char>>(data_size);
-		std::copy(data, &data[data_size], pkg.data->data());
 
 		std::vector<ResourceReference> default_references;
 		if (!references) {
@@ -215,19 +216,48 @@ using namespace GlacierFormats;
 		pkg.entry_descriptor.dependency_descriptor_size = references->size() * 9 + 4;
 
 		files.push_back(std::move(pkg));
+		return &files.back();
+	}
+
+	//transfers ownership of data ptr to RPKG
+	void RPKG::insertFile(RuntimeId runtime_id, const std::string& type, const char* data, size_t data_size, const std::vector<ResourceReference>* references) {
+		auto pkg = addFile(runtime_id, type, data_size, references);
+		if (!pkg)
+			return;
+
+		pkg->data = std::make_unique<std::vector<char>>(data_size);
+		std::copy(data, &data[data_size], pkg->data->data());
+
+		rebuildFileDataOffsets();
+	}
+
+	void RPKG::insertFile(RuntimeId runtime_id, const std::string& type, std::vector<BinaryWriterSegment> segments, const std::vector<ResourceReference>* references) {
+		size_t data_size = 0;
+		for (const auto& segment : segments)
+			data_size += segment.size;
+
+		auto pkg = addFile(runtime_id, type, data_size, references);
+		if (!pkg)
+			return;
+
+		//write() reads files without segments or data from the source archive, an empty payload needs an empty buffer.
+		if (segments.empty())
+			pkg->data = std::make_unique<std::vector<char>>();
+		else
+			pkg->segments = std::move(segments);
 
 		rebuildFileDataOffsets();
 	}
 
 	size_t RPKG::getEntryInfoSectionSize() const {
-		return files.size() * 0x14;
+		return files.size() * PkgFile::serialized_entry_info_size;
 	}
 
 	//TODO: this is kind of expensive to compute, turn into member var?
 	size_t RPKG::getEntryDescriptorSectionSize() const {
 		size_t descriptor_section_size = 0;
 		for (const auto& f : files)
-			descriptor_section_size += f.entry_descriptor.dependency_descriptor_size + 6 * 4;
+			descriptor_section_size += f.entry_descriptor.dependency_descriptor_size + PkgFile::serialized_entry_descriptor_header_size;
 		return descriptor_section_size;
 	}
 
@@ -262,7 +292,24 @@ using namespace GlacierFormats;
 	*/
 	void RPKG::write(std::filesystem::path dst_path) {
 
-		BinaryWriter bw(dst_path);
+		//The final archive size is known up front, the archive is written to a memory mapping of that size.
+		size_t archive_size = getDataSectionOffset();
+		size_t data_end = archive_size;
+		for (const auto& f : files) {
+			if (!f.segments.empty()) {
+				archive_size += f.entry_descriptor.size;
+			}
+			else if (f.data == nullptr) {
+				archive_size += f.entry_info.is_compressed ? f.entry_info.compressed_size : f.entry_descriptor.size;
+			}
+			else {
+				data_end = std::max(data_end, archive_size + f.data->size());
+				archive_size += f.entry_descriptor.size;
+			}
+		}
+		archive_size = std::max(archive_size, data_end);
+
+		BinaryWriter bw(std::make_unique<BinaryWriterMappedFileSink>(dst_path, archive_size));
 
 		//write header
 		uint32_t file_num = files.size();
@@ -289,7 +336,16 @@ using namespace GlacierFormats;
 
 		for (auto& f : files) {
 			size_t data_size = 0;
-			if (f.data == nullptr) {
+			if (!f.segments.empty()) {
+				data_size = f.entry_descriptor.size;
+
+				bw.seek(current_data_offset);
+				bw.writeSegments(f.segments);
+
+				f.entry_info.data_offset = current_data_offset;
+				current_data_offset += data_size;
+			}
+			else if (f.data == nullptr) {
 				if (f.entry_info.is_compressed) {
 					data_size = f.entry_info.compressed_size;
 				}
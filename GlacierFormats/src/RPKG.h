@@ -3,8 +3,10 @@
 #include <cstdint>
 #include <filesystem>
 #include <unordered_map>
+#include <array>
 #include "BinaryWriter.hpp"
 #include "BinaryReader.hpp"
+#include "BinaryLayout.h"
 #include "GlacierResource.h"
 #include "GlacierTypes.h"
 #include "ResourceReference.h"
@@ -34,6 +36,18 @@ namespace GlacierFormats {
 
 			void read(BinaryReader& br);
 			void write(BinaryWriter& bw) const;
+
+			//Compressed size, the top bit flags encrypted data.
+			struct PackedSize {
+				using Packed = uint32_t;
+				static void decode(EntryInfo& info, const uint32_t& zsize);
+				static uint32_t encode(const EntryInfo& info);
+			};
+
+			using Layout = BinaryLayout<EntryInfo,
+				Field<&EntryInfo::runtimeID>,
+				Field<&EntryInfo::data_offset>,
+				EncodedField<EntryInfo, PackedSize>>;
 		};
 
 		struct EntryDescriptor {
@@ -50,12 +64,33 @@ namespace GlacierFormats {
 
 			void read(BinaryReader& br);
 			void write(BinaryWriter& bw) const;
+
+			//Resource type, stored as reversed four character code.
+			struct PackedType {
+				using Packed = std::array<char, 4>;
+				static void decode(EntryDescriptor& descriptor, const Packed& type);
+				static Packed encode(const EntryDescriptor& descriptor);
+			};
+
+			//Fixed size part of the descriptor, followed by dependency_descriptor_size bytes of dependency data.
+			using HeaderLayout = BinaryLayout<EntryDescriptor,
+				EncodedField<EntryDescriptor, PackedType>,
+				Field<&EntryDescriptor::dependency_descriptor_size>,
+				Field<&EntryDescriptor::chunk_size>,
+				Field<&EntryDescriptor::size>,
+				Field<&EntryDescriptor::mem_size>,
+				Field<&EntryDescriptor::video_mem_size>>;
 		};
 
+	public:
+		static constexpr size_t serialized_entry_info_size = EntryInfo::Layout::size;
+		static constexpr size_t serialized_entry_descriptor_header_size = EntryDescriptor::HeaderLayout::size;
+
 	public:
 		EntryInfo entry_info;
 		EntryDescriptor entry_descriptor;
 		std::unique_ptr<std::vector<char>> data;
+		std::vector<BinaryWriterSegment> segments;//Data of files inserted as segments, written instead of data if not empty.
 	};
 
 
@@ -72,6 +107,7 @@ namespace GlacierFormats {
 		size_t getEntryDescriptorSectionSize() const;
 
 		void rebuildFileDataOffsets();
+		PkgFile* addFile(RuntimeId runtime_id, const std::string& type, size_t data_size, const std::vector<ResourceReference>* references);
 
 	public:
 
@@ -93,6 +129,9 @@ namespace GlacierFormats {
 		void write(std::filesystem::path dst_path);
 		void insertFile(RuntimeId runtime_id, const std::string& type, const std::vector<char>& data, const std::vector<ResourceReference>* references = nullptr);
 		void insertFile(RuntimeId runtime_id, const std::string& type, const char* data, size_t data_size, const std::vector<ResourceReference>* references = nullptr);
+		//Inserts a file without copying its data, e.g. the result of GlacierResource::serializeToSegments.
+		//Borrowed segments have to stay valid until the archive is written.
+		void insertFile(RuntimeId runtime_id, const std::string& type, std::vector<BinaryWriterSegment> segments, const std::vector<ResourceReference>* references = nullptr);
 
 		/*Allocates memory at *dst_buf, fills it with decytped/decompressed data and returns the size
 		of allocated memory. Freeing the allocated memory is responsibility of the called.
@@ -0,0 +1,104 @@
+#include "ReadCoverage.h"
+#include <algorithm>
+
+using namespace GlacierFormats;
+
+	ReadCoverage::ReadCoverage(int64_t total_size) : total_size(total_size), covered_size(0) {
+
+	}
+
+	//Inserts [begin, end) and merges it with all overlapping and adjacent intervals.
+	void ReadCoverage::insertMerged(IntervalSet& set, int64_t begin, int64_t end) {
+		auto it = set.upper_bound(begin);
+		if (it != set.begin() && std::prev(it)->second >= begin)
+			--it;
+
+		while (it != set.end() && it->first <= end) {
+			begin = std::min(begin, it->first);
+			end = std::max(end, it->second);
+			it = set.erase(it);
+		}
+		set.emplace_hint(it, begin, end);
+	}
+
+	void ReadCoverage::add(int64_t begin, int64_t end) {
+		if (begin >= end)
+			return;
+
+		//Fast path for sequential reads that continue the last interval.
+		if (!covered.empty()) {
+			auto last = std::prev(covered.end());
+			if (last->second == begin) {
+				last->second = end;
+				covered_size += end - begin;
+				return;
+			}
+		}
+
+		//Parts of the new range that are already covered are repeated reads.
+		auto it = covered.upper_bound(begin);
+		if (it != covered.begin())
+			--it;
+		for (; it != covered.end() && it->first < end; ++it) {
+			const auto overlap_begin = std::max(begin, it->first);
+			const auto overlap_end = std::min(end, it->second);
+			if (overlap_begin < overlap_end) {
+				insertMerged(repeated, overlap_begin, overlap_end);
+				covered_size -= overlap_end - overlap_begin;
+			}
+		}
+
+		insertMerged(covered, begin, end);
+		covered_size += end - begin;
+	}
+
+	int64_t ReadCoverage::totalSize() const noexcept {
+		return total_size;
+	}
+
+	int64_t ReadCoverage::coveredSize() const noexcept {
+		return covered_size;
+	}
+
+	float ReadCoverage::coverage() const noexcept {
+		if (total_size == 0)
+			return 1.0f;
+		return static_cast<float>(covered_size) / static_cast<float>(total_size);
+	}
+
+	bool ReadCoverage::isComplete() const noexcept {
+		return covered_size == total_size;
+	}
+
+	bool ReadCoverage::hasRepeatedReads() const noexcept {
+		return !repeated.empty();
+	}
+
+	std::vector<ByteRange> ReadCoverage::coveredRanges() const {
+		std::vector<ByteRange> ranges;
+		ranges.reserve(covered.size());
+		for (const auto& [begin, end] : covered)
+			ranges.push_back({ begin, end });
+		return ranges;
+	}
+
+	std::vector<ByteRange> ReadCoverage::gaps() const {
+		std::vector<ByteRange> ranges;
+		int64_t pos = 0;
+		for (const auto& [begin, end] : covered) {
+			if (begin > pos)
+				ranges.push_back({ pos, begin });
+			pos = end;
+		}
+		if (pos < total_size)
+			ranges.push_back({ pos, total_size });
+		return ranges;
+	}
+
+	std::vector<ByteRange> ReadCoverage::repeatedRanges() const {
+		std::vector<ByteRange> ranges;
+		ranges.reserve(repeated.size());
+		for (const auto& [begin, end] : repeated)
+			ranges.push_back({ begin, end });
+		return ranges;
+	}
@@ -0,0 +1,52 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <cinttypes>
+
+namespace GlacierFormats {
+
+	//Half-open byte range [begin, end).
+	struct ByteRange {
+		int64_t begin;
+		int64_t end;
+
+		int64_t size() const noexcept {
+			return end - begin;
+		}
+	};
+
+	//Set of read byte ranges of a resource. Reads are merged into disjoint intervals as they are added, 
+	//ranges that were read more than once are tracked in a second interval set.
+	class ReadCoverage {
+	private:
+		//Disjoint, non-adjacent intervals, keyed by begin. Value is the end of the interval.
+		using IntervalSet = std::map<int64_t, int64_t>;
+
+		IntervalSet covered;
+		IntervalSet repeated;
+		int64_t total_size;
+		int64_t covered_size;
+
+		static void insertMerged(IntervalSet& set, int64_t begin, int64_t end);
+
+	public:
+		explicit ReadCoverage(int64_t total_size);
+
+		void add(int64_t begin, int64_t end);
+
+		int64_t totalSize() const noexcept;
+		int64_t coveredSize() const noexcept;
+
+		//Fraction of bytes that were read at least once.
+		float coverage() const noexcept;
+		bool isComplete() const noexcept;
+		bool hasRepeatedReads() const noexcept;
+
+		std::vector<ByteRange> coveredRanges() const;
+		//Ranges that were never read.
+		std::vector<ByteRange> gaps() const;
+		//Ranges that were read more than once.
+		std::vector<ByteRange> repeatedRanges() const;
+	};
+
+}
@@ -0,0 +1,100 @@
+#include "RepositoryDiff.h"
+#include "ResourceRepository.h"
+#include "ThreadPool.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace GlacierFormats;
+
+namespace {
+
+	uint32_t storedSize(const ResourceInfo& info, const ResourceHeader& header) {
+		return info.isCompressed() ? info.compressedDataSize() : header.data_size;
+	}
+
+	//Cheap comparison that only uses the archive indices.
+	bool metadataEquals(const RepositorySnapshot::Entry& a, const RepositorySnapshot::Entry& b) {
+		if (a.info->zsize != b.info->zsize)
+			return false;
+		if (std::memcmp(a.header->type, b.header->type, sizeof(a.header->type)) != 0)
+			return false;
+		if ((a.header->data_size != b.header->data_size) || (a.header->memory_size != b.header->memory_size) || (a.header->video_memory_size != b.header->video_memory_size))
+			return false;
+		if (a.header->reference_chunk_size != b.header->reference_chunk_size)
+			return false;
+		return std::memcmp(a.header->references, b.header->references, a.header->reference_chunk_size) == 0;
+	}
+
+	bool sameStorage(const ArchiveIndex& a, const RepositorySnapshot::Entry& ea, const ArchiveIndex& b, const RepositorySnapshot::Entry& eb) {
+		if (ea.info->data_offset != eb.info->data_offset)
+			return false;
+		if (&a == &b)
+			return true;
+		return (a.path == b.path) && (a.file_size == b.file_size) && (a.write_time == b.write_time);
+	}
+
+	size_t storedDataHash(const ArchiveIndex& archive, const RepositorySnapshot::Entry& entry) {
+		std::vector<char> data(storedSize(*entry.info, *entry.header));
+		archive.read(entry.info->data_offset, data.data(), data.size());
+		return hash::fnv1a(data);
+	}
+
+	bool idLess(const RuntimeId& a, const RuntimeId& b) {
+		return static_cast<uint64_t>(a) < static_cast<uint64_t>(b);
+	}
+}
+
+	RepositoryDiff GlacierFormats::diffRepositories(const RepositorySnapshot& from, const RepositorySnapshot& to, ThreadPool& pool) {
+		RepositoryDiff diff;
+
+		for (const auto& entry : to.entries) {
+			if (!from.find(entry.first))
+				diff.added.push_back(entry.first);
+		}
+
+		std::vector<std::pair<const RepositorySnapshot::Entry*, const RepositorySnapshot::Entry*>> candidates;
+		std::vector<RuntimeId> candidate_ids;
+		for (const auto& entry : from.entries) {
+			const auto to_entry = to.find(entry.first);
+			if (!to_entry) {
+				diff.removed.push_back(entry.first);
+				continue;
+			}
+
+			if (!metadataEquals(entry.second, *to_entry)) {
+				diff.changed.push_back(entry.first);
+				continue;
+			}
+
+			const auto& from_archive = *from.archives[entry.second.archive];
+			const auto& to_archive = *to.archives[to_entry->archive];
+			if (sameStorage(from_archive, entry.second, to_archive, *to_entry))
+				continue;
+
+			candidates.emplace_back(&entry.second, to_entry);
+			candidate_ids.push_back(entry.first);
+		}
+
+		//Only entries with matching meta data but different storage location are read.
+		std::vector<char> data_changed(candidates.size(), 0);
+		pool.parallelFor(candidates.size(), [&](size_t i) {
+			const auto& from_entry = *candidates[i].first;
+			const auto& to_entry = *candidates[i].second;
+			data_changed[i] = storedDataHash(*from.archives[from_entry.archive], from_entry) != storedDataHash(*to.archives[to_entry.archive], to_entry);
+		});
+
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			if (data_changed[i])
+				diff.changed.push_back(candidate_ids[i]);
+		}
+
+		std::sort(diff.added.begin(), diff.added.end(), idLess);
+		std::sort(diff.removed.begin(), diff.removed.end(), idLess);
+		std::sort(diff.changed.begin(), diff.changed.end(), idLess);
+		return diff;
+	}
+
+	RepositoryDiff GlacierFormats::diffRepositories(const ResourceRepository& from, const ResourceRepository& to) {
+		return diffRepositories(*from.snapshot(), *to.snapshot(), from.getContext()->pool());
+	}
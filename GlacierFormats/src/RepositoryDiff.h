@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "GlacierTypes.h"
+
+namespace GlacierFormats {
+
+	class ThreadPool;
+	class RepositorySnapshot;
+	class ResourceRepository;
+
+	//Resources that differ between two repositories. All lists are sorted by id.
+	struct RepositoryDiff {
+		std::vector<RuntimeId> added;		//Only in the second repository
+		std::vector<RuntimeId> removed;		//Only in the first repository
+		std::vector<RuntimeId> changed;		//In both repositories with different type, sizes, references or data
+	};
+
+	//Compares two repository snapshots. Entries are compared by type, sizes and references first, entries that match and 
+	//aren't stored at the same location of the same archive file are compared by a hash of the data as it's stored in the 
+	//archive. Nothing is decompressed. Note that identical resources that were compressed differently are reported as changed.
+	RepositoryDiff diffRepositories(const RepositorySnapshot& from, const RepositorySnapshot& to, ThreadPool& pool);
+
+	//Uses the thread pool of the context of from.
+	RepositoryDiff diffRepositories(const ResourceRepository& from, const ResourceRepository& to);
+
+}
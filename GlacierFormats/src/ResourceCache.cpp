@@ -0,0 +1,72 @@
+#include "ResourceCache.h"
+
+using namespace GlacierFormats;
+
+	bool ResourceCache::Key::operator==(const Key& other) const noexcept {
+		return (archive == other.archive) && (offset == other.offset);
+	}
+
+	size_t ResourceCache::KeyHash::operator()(const Key& key) const noexcept {
+		return std::hash<uint64_t>{}(key.offset ^ (key.archive * 0x9E3779B97F4A7C15));
+	}
+
+	ResourceCache::ResourceCache(size_t byte_budget) : byte_budget(byte_budget), used_bytes(0) {
+
+	}
+
+	bool ResourceCache::enabled() const noexcept {
+		return byte_budget.load() != 0;
+	}
+
+	size_t ResourceCache::budget() const noexcept {
+		return byte_budget.load();
+	}
+
+	void ResourceCache::setBudget(size_t budget) {
+		std::lock_guard<std::mutex> lock(mutex);
+		byte_budget = budget;
+		evict();
+	}
+
+	size_t ResourceCache::size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return used_bytes;
+	}
+
+	void ResourceCache::evict() {
+		while (used_bytes > byte_budget.load() && !lru.empty()) {
+			used_bytes -= lru.back().second->size();
+			entries.erase(lru.back().first);
+			lru.pop_back();
+		}
+	}
+
+	ResourceCache::Payload ResourceCache::find(const Key& key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = entries.find(key);
+		if (it == entries.end())
+			return nullptr;
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->second;
+	}
+
+	void ResourceCache::insert(const Key& key, Payload payload) {
+		if (!payload || payload->size() > byte_budget.load())
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (entries.find(key) != entries.end())
+			return;
+
+		used_bytes += payload->size();
+		lru.emplace_front(key, std::move(payload));
+		entries[key] = lru.begin();
+		evict();
+	}
+
+	void ResourceCache::clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		lru.clear();
+		used_bytes = 0;
+	}
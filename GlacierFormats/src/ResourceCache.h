@@ -0,0 +1,58 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cinttypes>
+#include <unordered_map>
+
+namespace GlacierFormats {
+
+	//Byte-budgeted LRU cache of decompressed resource payloads. Entries are keyed by archive and data offset instead of
+	//runtime id since the same id can resolve to different data in different repositories.
+	//A budget of 0 disables the cache.
+	class ResourceCache {
+	public:
+		struct Key {
+			uint64_t archive;	//ArchiveIndex::serial
+			uint64_t offset;
+
+			bool operator==(const Key& other) const noexcept;
+		};
+
+		using Payload = std::shared_ptr<const std::vector<char>>;
+
+	private:
+		struct KeyHash {
+			size_t operator()(const Key& key) const noexcept;
+		};
+
+		using LruList = std::list<std::pair<Key, Payload>>;
+
+		mutable std::mutex mutex;
+		LruList lru;
+		std::unordered_map<Key, LruList::iterator, KeyHash> entries;
+		std::atomic<size_t> byte_budget;
+		size_t used_bytes;
+
+		void evict();
+
+	public:
+		explicit ResourceCache(size_t byte_budget = 0);
+		ResourceCache(const ResourceCache&) = delete;
+		ResourceCache& operator=(const ResourceCache&) = delete;
+
+		[[nodiscard]] bool enabled() const noexcept;
+		size_t budget() const noexcept;
+		void setBudget(size_t byte_budget);
+		size_t size() const;
+
+		//Returns nullptr on miss.
+		Payload find(const Key& key);
+		//Payloads larger than the budget are not cached.
+		void insert(const Key& key, Payload payload);
+		void clear();
+	};
+
+}
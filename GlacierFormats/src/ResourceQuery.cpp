@@ -0,0 +1,173 @@
+#include "ResourceQuery.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace GlacierFormats;
+
+	size_t ResourceMetadataIndex::size() const noexcept {
+		return ids.size();
+	}
+
+	uint32_t ResourceMetadataIndex::encodeType(const std::string& type) {
+		//Type tags are stored reversed in the archive, see ResourceRepository::getIdsByType.
+		char tag[4]{};
+		std::copy_n(type.begin(), std::min<size_t>(type.size(), sizeof(tag)), tag);
+		std::reverse(std::begin(tag), std::end(tag));
+		uint32_t encoded;
+		std::memcpy(&encoded, tag, sizeof(encoded));
+		return encoded;
+	}
+
+	void GlacierFormats::parallelForRange(ThreadPool& pool, size_t count, const std::function<void(size_t first, size_t last)>& fn) {
+		//Below this size the task overhead dominates.
+		constexpr size_t min_chunk_size = 0x4000;
+
+		const size_t chunk_count = std::min(pool.threadCount(), (count + min_chunk_size - 1) / min_chunk_size);
+		if (chunk_count <= 1) {
+			fn(0, count);
+			return;
+		}
+
+		const size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+		pool.parallelFor(chunk_count, [&](size_t chunk) {
+			const size_t first = chunk * chunk_size;
+			fn(first, std::min(count, first + chunk_size));
+		});
+	}
+
+	ResourcePredicate::ResourcePredicate(Evaluator evaluator) : evaluator(std::move(evaluator)) {
+
+	}
+
+	ResourcePredicate::Mask ResourcePredicate::evaluate(const ResourceMetadataIndex& index, ThreadPool& pool) const {
+		Mask mask(index.size(), 0);
+		evaluator(index, mask, pool);
+		return mask;
+	}
+
+	ResourcePredicate GlacierFormats::operator&&(const ResourcePredicate& lhs, const ResourcePredicate& rhs) {
+		return ResourcePredicate([lhs, rhs](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			mask = lhs.evaluate(index, pool);
+			const auto rhs_mask = rhs.evaluate(index, pool);
+			parallelForRange(pool, mask.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i)
+					mask[i] = mask[i] && rhs_mask[i];
+			});
+		});
+	}
+
+	ResourcePredicate GlacierFormats::operator||(const ResourcePredicate& lhs, const ResourcePredicate& rhs) {
+		return ResourcePredicate([lhs, rhs](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			mask = lhs.evaluate(index, pool);
+			const auto rhs_mask = rhs.evaluate(index, pool);
+			parallelForRange(pool, mask.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i)
+					mask[i] = mask[i] || rhs_mask[i];
+			});
+		});
+	}
+
+	ResourcePredicate GlacierFormats::operator!(const ResourcePredicate& predicate) {
+		return ResourcePredicate([predicate](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			mask = predicate.evaluate(index, pool);
+			parallelForRange(pool, mask.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i)
+					mask[i] = !mask[i];
+			});
+		});
+	}
+
+	std::vector<RuntimeId> GlacierFormats::runQuery(const ResourceMetadataIndex& index, const ResourcePredicate& predicate, ThreadPool& pool) {
+		const auto mask = predicate.evaluate(index, pool);
+		std::vector<RuntimeId> ids;
+		for (size_t i = 0; i < mask.size(); ++i)
+			if (mask[i])
+				ids.push_back(index.ids[i]);
+		return ids;
+	}
+
+	ResourcePredicate query::all() {
+		return ResourcePredicate([](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			std::fill(mask.begin(), mask.end(), 1);
+		});
+	}
+
+	ResourcePredicate query::type(const std::string& type) {
+		const auto encoded_type = ResourceMetadataIndex::encodeType(type);
+		return ResourcePredicate([encoded_type](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			parallelForRange(pool, index.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i)
+					mask[i] = index.types[i] == encoded_type;
+			});
+		});
+	}
+
+	ResourcePredicate query::archive(const std::string& name_sub_string) {
+		return ResourcePredicate([name_sub_string](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			//Resolve the archive names once, the column scan only compares archive indices.
+			std::vector<char> archive_matches(index.archive_names.size(), 0);
+			for (size_t a = 0; a < index.archive_names.size(); ++a)
+				archive_matches[a] = index.archive_names[a].find(name_sub_string) != std::string::npos;
+
+			parallelForRange(pool, index.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i)
+					mask[i] = archive_matches[index.archives[i]];
+			});
+		});
+	}
+
+	ResourcePredicate query::referencesType(const std::string& type) {
+		return references(query::type(type));
+	}
+
+	ResourcePredicate query::references(const ResourcePredicate& predicate) {
+		return ResourcePredicate([predicate](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			const auto targets = predicate.evaluate(index, pool);
+			parallelForRange(pool, index.size(), [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i) {
+					char match = 0;
+					for (auto r = index.reference_offsets[i]; r < index.reference_offsets[i + 1] && !match; ++r) {
+						const auto row = index.reference_rows[r];
+						match = (row != ResourceMetadataIndex::npos) && targets[row];
+					}
+					mask[i] = match;
+				}
+			});
+		});
+	}
+
+	ResourcePredicate query::referencedBy(const ResourcePredicate& predicate) {
+		return ResourcePredicate([predicate](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+			const auto sources = predicate.evaluate(index, pool);
+			//Scatter is done serially, concurrent writes to the same row would race.
+			for (size_t i = 0; i < index.size(); ++i) {
+				if (!sources[i])
+					continue;
+				for (auto r = index.reference_offsets[i]; r < index.reference_offsets[i + 1]; ++r) {
+					const auto row = index.reference_rows[r];
+					if (row != ResourceMetadataIndex::npos)
+						mask[row] = 1;
+				}
+			}
+		});
+	}
+
+	ResourceColumn<uint32_t> query::compressedSize() {
+		return ResourceColumn<uint32_t>(&ResourceMetadataIndex::compressed_sizes);
+	}
+
+	ResourceColumn<uint32_t> query::dataSize() {
+		return ResourceColumn<uint32_t>(&ResourceMetadataIndex::data_sizes);
+	}
+
+	ResourceColumn<int32_t> query::memorySize() {
+		return ResourceColumn<int32_t>(&ResourceMetadataIndex::memory_sizes);
+	}
+
+	ResourceColumn<int32_t> query::videoMemorySize() {
+		return ResourceColumn<int32_t>(&ResourceMetadataIndex::video_memory_sizes);
+	}
+
+	ResourceColumn<uint32_t> query::referenceCount() {
+		return ResourceColumn<uint32_t>(&ResourceMetadataIndex::reference_counts);
+	}
@@ -0,0 +1,121 @@
+#pragma once
+#include "GlacierTypes.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <cinttypes>
+#include <functional>
+#include <unordered_map>
+
+namespace GlacierFormats {
+
+	//Column-wise copy of the ResourceRepository meta data. Every vector holds one entry per resource (row).
+	//Rows are sorted by runtime id. References are stored in CSR form: the references of row i are
+	//reference_rows[reference_offsets[i] .. reference_offsets[i + 1]]. References to resources that don't
+	//exist in the repository are stored as ResourceMetadataIndex::npos.
+	struct ResourceMetadataIndex {
+		static constexpr uint32_t npos = 0xFFFFFFFF;
+
+		std::vector<RuntimeId> ids;
+		std::vector<uint32_t> types;				//Raw little endian type tags as found in the archive. See encodeType.
+		std::vector<uint16_t> archives;				//Index into archive_names
+		std::vector<uint32_t> compressed_sizes;		//Size of the resource data inside the archive.
+		std::vector<uint32_t> data_sizes;			//Size of the decompressed resource data.
+		std::vector<int32_t> memory_sizes;
+		std::vector<int32_t> video_memory_sizes;
+		std::vector<uint32_t> reference_counts;
+
+		std::vector<uint32_t> reference_offsets;
+		std::vector<uint32_t> reference_rows;
+
+		std::vector<std::string> archive_names;
+		std::unordered_map<RuntimeId, uint32_t> rows;
+
+		size_t size() const noexcept;
+
+		//Converts a type string like "PRIM" into the representation used by ResourceMetadataIndex::types.
+		static uint32_t encodeType(const std::string& type);
+	};
+
+	//Predicate over the rows of a ResourceMetadataIndex. Predicates are evaluated one column at a time,
+	//each leaf produces a mask for the whole index in parallel, inner nodes combine masks.
+	//Predicates are built from the factory functions in GlacierFormats::query and combined with &&, || and !.
+	class ResourcePredicate {
+	public:
+		using Mask = std::vector<char>;
+		using Evaluator = std::function<void(const ResourceMetadataIndex& index, Mask& mask, ThreadPool& pool)>;
+
+	private:
+		Evaluator evaluator;
+
+	public:
+		explicit ResourcePredicate(Evaluator evaluator);
+
+		//Returns a mask with one entry per row of the index. Non-zero entries match the predicate.
+		//Column scans run on pool.
+		Mask evaluate(const ResourceMetadataIndex& index, ThreadPool& pool) const;
+
+		friend ResourcePredicate operator&&(const ResourcePredicate& lhs, const ResourcePredicate& rhs);
+		friend ResourcePredicate operator||(const ResourcePredicate& lhs, const ResourcePredicate& rhs);
+		friend ResourcePredicate operator!(const ResourcePredicate& predicate);
+	};
+
+	//Splits [0, count) into chunks and runs fn(first, last) on all of them concurrently on pool.
+	void parallelForRange(ThreadPool& pool, size_t count, const std::function<void(size_t first, size_t last)>& fn);
+
+	//Numeric column of the ResourceMetadataIndex. Comparisons with a constant yield predicates.
+	template<typename T>
+	class ResourceColumn {
+	private:
+		std::vector<T> ResourceMetadataIndex::* column;
+
+		template<typename Compare>
+		ResourcePredicate compare(int64_t value, Compare cmp) const {
+			auto col = column;
+			return ResourcePredicate([col, value, cmp](const ResourceMetadataIndex& index, ResourcePredicate::Mask& mask, ThreadPool& pool) {
+				const auto& values = index.*col;
+				parallelForRange(pool, values.size(), [&](size_t first, size_t last) {
+					for (size_t i = first; i < last; ++i)
+						mask[i] = cmp(static_cast<int64_t>(values[i]), value);
+				});
+			});
+		}
+
+	public:
+		constexpr ResourceColumn(std::vector<T> ResourceMetadataIndex::* column) : column(column) {}
+
+		ResourcePredicate operator==(int64_t value) const { return compare(value, std::equal_to<int64_t>{}); }
+		ResourcePredicate operator!=(int64_t value) const { return compare(value, std::not_equal_to<int64_t>{}); }
+		ResourcePredicate operator<(int64_t value) const { return compare(value, std::less<int64_t>{}); }
+		ResourcePredicate operator<=(int64_t value) const { return compare(value, std::less_equal<int64_t>{}); }
+		ResourcePredicate operator>(int64_t value) const { return compare(value, std::greater<int64_t>{}); }
+		ResourcePredicate operator>=(int64_t value) const { return compare(value, std::greater_equal<int64_t>{}); }
+	};
+
+	//Returns the ids of all rows that match the predicate, in row order.
+	std::vector<RuntimeId> runQuery(const ResourceMetadataIndex& index, const ResourcePredicate& predicate, ThreadPool& pool = ThreadPool::defaultPool());
+
+	//Predicate and column factories. Example:
+	//	using namespace GlacierFormats::query;
+	//	auto ids = repo->query(type("TEXD") && dataSize() > 4 * 1024 * 1024 && archive("dlc") && referencedBy(type("MATI") && referenceCount() > 8));
+	namespace query {
+
+		ResourcePredicate all();
+		ResourcePredicate type(const std::string& type);
+		//Matches resources read from archives whose name contains the given sub string.
+		ResourcePredicate archive(const std::string& name_sub_string);
+		//Matches resources that reference at least one resource of the given type.
+		ResourcePredicate referencesType(const std::string& type);
+		//Matches resources that reference at least one resource matching the predicate.
+		ResourcePredicate references(const ResourcePredicate& predicate);
+		//Matches resources that are referenced by at least one resource matching the predicate.
+		ResourcePredicate referencedBy(const ResourcePredicate& predicate);
+
+		ResourceColumn<uint32_t> compressedSize();
+		ResourceColumn<uint32_t> dataSize();
+		ResourceColumn<int32_t> memorySize();
+		ResourceColumn<int32_t> videoMemorySize();
+		ResourceColumn<uint32_t> referenceCount();
+	}
+
+}
@@ -3,7 +3,9 @@
 #include <thread>
 #include <string>
 #include "ResourceRepository.h"
+#include "ResourceQuery.h"
 #include "Crypto.h"
+#include "Hash.h"
 #include "PRIM.h"
 #include "lz4.h"
 
@@ -58,59 +60,198 @@ std::filesystem::path ResourceRepository::runtime_dir = std::filesystem::path();
 		return references;
 	}
 
-	ResourceRepositoryData::ResourceRepositoryData(const std::filesystem::path& runtime_path) {
-		//TODO: Implement mechanism that excludes user defined patches.
-		//Could be based on a unique key in the deletion list. 
-		std::vector<std::filesystem::path> rpkg_file_paths;
-		for (const auto& it : std::filesystem::directory_iterator(runtime_path)) {
-			if (it.is_regular_file() && (it.path().extension().generic_string() == ".rpkg")) {
-				rpkg_file_paths.push_back(it.path());
+	namespace {
+		std::vector<std::filesystem::path> findArchivePaths(const std::filesystem::path& runtime_path) {
+			//TODO: Implement mechanism that excludes user defined patches.
+			//Could be based on a unique key in the deletion list. 
+			std::vector<std::filesystem::path> rpkg_file_paths;
+			for (const auto& it : std::filesystem::directory_iterator(runtime_path)) {
+				if (it.is_regular_file() && (it.path().extension().generic_string() == ".rpkg")) {
+					rpkg_file_paths.push_back(it.path());
+				}
 			}
+			std::sort(rpkg_file_paths.begin(), rpkg_file_paths.end(), std::less<std::filesystem::path>());
+			return rpkg_file_paths;
 		}
-		std::sort(rpkg_file_paths.begin(), rpkg_file_paths.end(), std::less<std::filesystem::path>());
 
-		for (const auto& s : rpkg_file_paths) {
-			stream_names.push_back(s.stem().generic_string());
-			streams.emplace_back(s, std::ifstream::binary);
-			auto& ifs = streams.back();
+		std::vector<std::shared_ptr<const ArchiveIndex>> indexArchives(const std::vector<std::filesystem::path>& paths, ThreadPool& pool) {
+			std::vector<std::shared_ptr<const ArchiveIndex>> archives(paths.size());
+			pool.parallelFor(paths.size(), [&](size_t i) {
+				//Archives that can't be indexed, e.g. because they are still being copied, are left null.
+				try {
+					archives[i] = std::make_shared<const ArchiveIndex>(paths[i]);
+				}
+				catch (const std::exception&) {
+					archives[i] = nullptr;
+				}
+			});
+			return archives;
+		}
 
-			Header repo_header;
-			ifs.read((char*)&repo_header, sizeof(Header));
+		std::atomic<uint64_t> next_archive_serial(0);
 
-			//TODO: It's probably better to check for the substring "patch" in the file name. The check below is a bit scuffed.
-			if ((repo_header.deletion_block_id_count & 0xFFFF0000) == 0)
-				ifs.seekg(sizeof(Header) + repo_header.deletion_block_id_count * sizeof(RuntimeId));
-			else
-				ifs.seekg(sizeof(Header) - 4);
+		uint64_t archiveIdentity(const std::string& name, uintmax_t file_size, std::filesystem::file_time_type write_time) {
+			const auto write_time_ticks = write_time.time_since_epoch().count();
+			auto identity = hash::fnv1a(std::vector<char>(name.begin(), name.end()));
+			identity = (identity ^ hash::fnv1a(file_size)) * 0x00000100000001B3;
+			identity = (identity ^ hash::fnv1a(write_time_ticks)) * 0x00000100000001B3;
+			return identity;
+		}
+	}
 
-			info_data.emplace_back(repo_header.entry_info_block_size / sizeof(ResourceInfo));
-			ifs.read(reinterpret_cast<char*>(info_data.back().data()), repo_header.entry_info_block_size);
+	ArchiveIndex::ArchiveIndex(const std::filesystem::path& path) : 
+		serial(next_archive_serial++),
+		path(path), 
+		name(path.stem().generic_string()), 
+		file_size(std::filesystem::file_size(path)), 
+		write_time(std::filesystem::last_write_time(path)), 
+		identity(archiveIdentity(name, file_size, write_time)) {
+
+		//The member stream is opened on the first read, archives that are never read from don't hold a file handle.
+		std::ifstream file(path, std::ifstream::binary);
+		auto fail = [&](const std::string& reason) {
+			return InvalidArgumentsException("Archive " + name + " can't be indexed: " + reason);
+		};
+
+		Header repo_header;
+		if (!file.read((char*)&repo_header, sizeof(Header)) || std::string(repo_header.magic, 4) != "GKPR")
+			throw fail("invalid header");
+
+		//TODO: It's probably better to check for the substring "patch" in the file name. The check below is a bit scuffed.
+		uint64_t info_offset = sizeof(Header) - 4;
+		if ((repo_header.deletion_block_id_count & 0xFFFF0000) == 0)
+			info_offset = sizeof(Header) + static_cast<uint64_t>(repo_header.deletion_block_id_count) * sizeof(RuntimeId);
+
+		const auto data_offset = info_offset + repo_header.entry_info_block_size + repo_header.entry_descriptor_block_size;
+		if ((repo_header.entry_info_block_size % sizeof(ResourceInfo)) != 0 || data_offset > file_size)
+			throw fail("index blocks exceed the file");
+
+		file.seekg(info_offset);
+		info_data.resize(repo_header.entry_info_block_size / sizeof(ResourceInfo));
+		if (!file.read(reinterpret_cast<char*>(info_data.data()), repo_header.entry_info_block_size))
+			throw fail("truncated entry info block");
+
+		header_data.resize(repo_header.entry_descriptor_block_size);
+		if (!file.read(header_data.data(), repo_header.entry_descriptor_block_size))
+			throw fail("truncated entry descriptor block");
+
+		//RepositorySnapshot walks the descriptors without bounds checks and readers trust the data ranges.
+		uint64_t header_data_offset = 0;
+		for (const auto& resource_info : info_data) {
+			if (header_data_offset + sizeof(ResourceHeader) > header_data.size())
+				throw fail("entry descriptor block too small");
+			const auto header_entry = reinterpret_cast<const ResourceHeader*>(&header_data[header_data_offset]);
+			header_data_offset += sizeof(ResourceHeader) + header_entry->reference_chunk_size;
+			if (header_data_offset > header_data.size())
+				throw fail("entry descriptor block too small");
+
+			const uint64_t stored_size = resource_info.isCompressed() ? resource_info.compressedDataSize() : header_entry->data_size;
+			if (resource_info.data_offset > file_size || stored_size > file_size - resource_info.data_offset)
+				throw fail("resource data exceeds the file");
+		}
+	}
 
-			header_data.emplace_back(repo_header.entry_descriptor_block_size);
-			ifs.read(header_data.back().data(), repo_header.entry_descriptor_block_size);
+	bool ArchiveIndex::isUpToDate() const {
+		std::error_code ec;
+		const auto current_size = std::filesystem::file_size(path, ec);
+		if (ec)
+			return false;
+		const auto current_write_time = std::filesystem::last_write_time(path, ec);
+		if (ec)
+			return false;
+		return (current_size == file_size) && (current_write_time == write_time);
+	}
 
+	void ArchiveIndex::read(uint64_t offset, char* dst, size_t size) const {
+		size_t read_size = 0;
+		{
+			std::lock_guard<std::mutex> lock(stream_mutex);
+			if (!stream.is_open())
+				stream.open(path, std::ifstream::binary);
+			//A previous short read leaves the stream failed, later reads would silently return nothing.
+			stream.clear();
+			stream.seekg(offset);
+			stream.read(dst, size);
+			read_size = static_cast<size_t>(stream.gcount());
 		}
+
+		//The offsets of this index are only valid for the indexed file. Checked after reading so that a modification
+		//during the read is detected as well.
+		if (!isUpToDate())
+			throw InvalidArgumentsException("Archive " + name + " was modified after it was indexed");
+		if (read_size != size)
+			throw InvalidArgumentsException("Read past the end of archive " + name);
 	}
 
-	ResourceRepository::ResourceRepository(const std::filesystem::path& runtime_path) : ResourceRepositoryData(runtime_path) {
-		for (int rpkg = 0; rpkg < info_data.size(); ++rpkg) {
+	RepositorySnapshot::RepositorySnapshot(std::vector<std::shared_ptr<const ArchiveIndex>> archives) : archives(std::move(archives)) {
+		for (uint32_t rpkg = 0; rpkg < this->archives.size(); ++rpkg) {
+			const auto& archive = *this->archives[rpkg];
 
 			uint64_t header_data_offset = 0;
-			auto header_data_base = header_data[rpkg].data();
-
-			for (int entry_index = 0; entry_index < info_data[rpkg].size(); ++entry_index) {
-				auto id = info_data[rpkg][entry_index].runtimeID;
-
-				info[id] = &info_data[rpkg][entry_index];
-				stream[id] = &streams[rpkg];
+			auto header_data_base = archive.header_data.data();
 
-				auto header_entry = reinterpret_cast<ResourceHeader*>(&header_data_base[header_data_offset]);
-				header[id] = header_entry;
+			for (const auto& resource_info : archive.info_data) {
+				auto header_entry = reinterpret_cast<const ResourceHeader*>(&header_data_base[header_data_offset]);
+				entries[resource_info.runtimeID] = Entry{ &resource_info, header_entry, rpkg };
 				header_data_offset += sizeof(ResourceHeader) + header_entry->reference_chunk_size;
 			}
 		}
 	}
 
+	const RepositorySnapshot::Entry* RepositorySnapshot::find(const RuntimeId& id) const {
+		auto it = entries.find(id);
+		if (it == entries.end())
+			return nullptr;
+		return &it->second;
+	}
+
+	bool RepositoryRefreshReport::empty() const noexcept {
+		return added.empty() && removed.empty() && changed.empty();
+	}
+
+	RepositoryContext::RepositoryContext(size_t cache_budget) : thread_pool(&ThreadPool::defaultPool()), resource_cache(cache_budget) {
+
+	}
+
+	RepositoryContext::RepositoryContext(size_t cache_budget, size_t thread_count) : 
+		owned_pool(std::make_unique<ThreadPool>(thread_count)), 
+		thread_pool(owned_pool.get()), 
+		resource_cache(cache_budget) {
+
+	}
+
+	std::shared_ptr<RepositoryContext> RepositoryContext::defaultContext() {
+		static auto context = std::make_shared<RepositoryContext>();
+		return context;
+	}
+
+	ThreadPool& RepositoryContext::pool() const noexcept {
+		return *thread_pool;
+	}
+
+	ResourceCache& RepositoryContext::cache() const noexcept {
+		return resource_cache;
+	}
+
+	void RepositoryContext::enablePersistentCache(const std::filesystem::path& directory) {
+		std::atomic_store(&persistent_cache, std::make_shared<PersistentResourceCache>(directory));
+	}
+
+	std::shared_ptr<PersistentResourceCache> RepositoryContext::persistentCache() const {
+		return std::atomic_load(&persistent_cache);
+	}
+
+	ResourceRepository::ResourceRepository(const std::filesystem::path& runtime_path, std::shared_ptr<RepositoryContext> context) : 
+		runtime_path(runtime_path), 
+		context(context ? std::move(context) : RepositoryContext::defaultContext()) {
+		auto archives = indexArchives(findArchivePaths(runtime_path), this->context->pool());
+		archives.erase(std::remove(archives.begin(), archives.end(), nullptr), archives.end());
+		current_snapshot = std::make_shared<const RepositorySnapshot>(std::move(archives));
+	}
+
+	ResourceRepository::~ResourceRepository() {
+
+	}
 
 	ResourceRepository* ResourceRepository::instance()
 	{
@@ -121,31 +262,106 @@ std::filesystem::path ResourceRepository::runtime_dir = std::filesystem::path();
 		return &repo;
 	}
 
+	const std::shared_ptr<RepositoryContext>& ResourceRepository::getContext() const noexcept {
+		return context;
+	}
+
+	std::shared_ptr<const RepositorySnapshot> ResourceRepository::snapshot() const {
+		return std::atomic_load(&current_snapshot);
+	}
+
+	RepositoryRefreshReport ResourceRepository::refresh() {
+		std::lock_guard<std::mutex> lock(refresh_mutex);
+		const auto old_snapshot = snapshot();
+
+		RepositoryRefreshReport report;
+		const auto paths = findArchivePaths(runtime_path);
+
+		std::vector<std::shared_ptr<const ArchiveIndex>> archives(paths.size());
+		std::vector<std::shared_ptr<const ArchiveIndex>> previous_archives(paths.size());
+		std::vector<std::filesystem::path> stale_paths;
+		for (size_t i = 0; i < paths.size(); ++i) {
+			auto it = std::find_if(old_snapshot->archives.begin(), old_snapshot->archives.end(), [&](const auto& archive) { return archive->path == paths[i]; });
+			if (it == old_snapshot->archives.end())
+				report.added.push_back(paths[i].stem().generic_string());
+			else if ((*it)->isUpToDate())
+				archives[i] = *it;
+			else {
+				report.changed.push_back((*it)->name);
+				previous_archives[i] = *it;
+			}
+
+			if (!archives[i])
+				stale_paths.push_back(paths[i]);
+		}
+
+		for (const auto& archive : old_snapshot->archives) {
+			if (std::find(paths.begin(), paths.end(), archive->path) == paths.end())
+				report.removed.push_back(archive->name);
+		}
+
+		if (report.empty())
+			return report;
+
+		//Only new and modified archives are read from disk.
+		auto fresh_archives = indexArchives(stale_paths, context->pool());
+		auto fresh_archive = fresh_archives.begin();
+		for (size_t i = 0; i < paths.size(); ++i) {
+			if (archives[i])
+				continue;
+			archives[i] = *fresh_archive++;
+			if (archives[i])
+				continue;
+
+			//Archives that failed to index keep their previous state and aren't reported, the next refresh retries them.
+			auto& names = previous_archives[i] ? report.changed : report.added;
+			names.erase(std::find(names.begin(), names.end(), paths[i].stem().generic_string()));
+			archives[i] = previous_archives[i];
+		}
+		archives.erase(std::remove(archives.begin(), archives.end(), nullptr), archives.end());
+
+		if (report.empty())
+			return report;
+
+		std::atomic_store(&current_snapshot, std::shared_ptr<const RepositorySnapshot>(std::make_shared<const RepositorySnapshot>(std::move(archives))));
+		return report;
+	}
+
 	bool ResourceRepository::contains(const RuntimeId& id) const noexcept {
-		return info.find(id) != info.end();
+		return snapshot()->find(id) != nullptr;
 	}
 
 	std::string ResourceRepository::getResourceType(const RuntimeId& id) const {
-		if (!contains(id))
+		const auto current = snapshot();
+		const auto entry = current->find(id);
+		if (!entry)
 			return "";
-		std::string type(header.at(id)->type, 4);
+		std::string type(entry->header->type, 4);
 		std::reverse(type.begin(), type.end());
 		return type;
 	}
 
 	std::vector<ResourceReference> ResourceRepository::getResourceReferences(const RuntimeId& id) const {
-		if (!contains(id))
+		const auto current = snapshot();
+		const auto entry = current->find(id);
+		if (!entry)
 			return std::vector<ResourceReference>();
-		return header.at(id)->getReferences();
+		return entry->header->getReferences();
 	}
 
 	std::vector<ResourceReference> ResourceRepository::getResourceReferences(const RuntimeId& id, const std::string& type) const {
-		if (!contains(id))
+		const auto current = snapshot();
+		const auto entry = current->find(id);
+		if (!entry)
 			return std::vector<ResourceReference>();
-		std::vector<ResourceReference> references = header.at(id)->getReferences();
+		std::vector<ResourceReference> references = entry->header->getReferences();
 		std::vector<ResourceReference> references_of_type;//TODO: Maybe erase instead?
 		for (const auto& reference : references) {
-			auto t = getResourceType(reference.id);
+			const auto reference_entry = current->find(reference.id);
+			if (!reference_entry)
+				continue;
+			std::string t(reference_entry->header->type, 4);
+			std::reverse(t.begin(), t.end());
 			if (type == t)
 				references_of_type.push_back(reference);
 		}
@@ -167,54 +383,68 @@ std::filesystem::path ResourceRepository::runtime_dir = std::filesystem::path();
 
 	std::vector<RuntimeId> GlacierFormats::ResourceRepository::getIds() const {
 		//TODO: This function is needlessly expensive, store id list in ResouceRepositoryData
+		const auto current = snapshot();
 		std::vector<RuntimeId> ids;
-		ids.reserve(header.size());
-		for (const auto& h : header)
-			ids.push_back(h.first);
+		ids.reserve(current->entries.size());
+		for (const auto& entry : current->entries)
+			ids.push_back(entry.first);
 		return ids;
 	}
 
 	std::vector<RuntimeId> ResourceRepository::getIdsByType(std::string type) const {
 		std::reverse(type.begin(), type.end());
 
+		const auto current = snapshot();
 		std::vector<RuntimeId> ids;
-		for (const auto& h : header) {
-			if (memcmp(h.second->type, type.data(), 4) == 0)
-				ids.push_back(h.first);
+		for (const auto& entry : current->entries) {
+			if (memcmp(entry.second.header->type, type.data(), 4) == 0)
+				ids.push_back(entry.first);
 		}
 		return ids;
 	}
 
 	const std::string ResourceRepository::getSourceStreamName(RuntimeId id) const {
-		if (!contains(id))
-			return "";
-
-		auto st = stream.at(id);
-		auto it = std::find_if(streams.begin(), streams.end(), [&st](const std::ifstream& s) { return &s == st; });
-		if (it == streams.end())
+		const auto current = snapshot();
+		const auto entry = current->find(id);
+		if (!entry)
 			return "";
-
-		auto idx = it - streams.begin();
-		return stream_names[idx];
+		return current->archives[entry->archive]->name;
 	}
 
 	uint64_t ResourceRepository::getResource(const RuntimeId& id, std::unique_ptr<char[]>& resource) const {
-		if (!contains(id))
+		const auto current = snapshot();
+		const auto entry = current->find(id);
+		if (!entry)
 			return 0;
 
-		auto src_stream = stream[id];
-		auto src_info = info.at(id);
-		auto src_header = header.at(id);
-
-		src_stream->seekg(src_info->data_offset);
+		const auto& src_archive = *current->archives[entry->archive];
+		auto src_info = entry->info;
+		auto src_header = entry->header;
 
 		auto uncompr_size = src_header->data_size;
 		resource = std::make_unique<char[]>(uncompr_size);
 
+		auto& cache = context->cache();
+		const ResourceCache::Key cache_key{ src_archive.serial, src_info->data_offset };
+		if (cache.enabled()) {
+			if (auto payload = cache.find(cache_key)) {
+				std::copy(payload->begin(), payload->end(), resource.get());
+				return uncompr_size;
+			}
+		}
+
+		const auto persistent_cache = context->persistentCache();
+		const PersistentResourceCache::Key persistent_key{ static_cast<uint64_t>(id), src_archive.identity, src_info->data_offset };
+		if (persistent_cache && persistent_cache->read(persistent_key, resource.get(), uncompr_size)) {
+			if (cache.enabled())
+				cache.insert(cache_key, std::make_shared<const std::vector<char>>(resource.get(), resource.get() + uncompr_size));
+			return uncompr_size;
+		}
+
 		if (src_info->isCompressed()) {
 			auto compr_size = src_info->compressedDataSize();
 			auto compr_data = std::make_unique<char[]>(compr_size);
-			src_stream->read(compr_data.get(), compr_size);
+			src_archive.read(src_info->data_offset, compr_data.get(), compr_size);
 
 			if (src_info->isEncrypted()) {
 				Crypto::rpkgXCrypt(compr_data.get(), compr_size);
@@ -224,12 +454,20 @@ std::filesystem::path ResourceRepository::runtime_dir = std::filesystem::path();
 				throw "Decompression error";
 		}
 		else {
-			src_stream->read(resource.get(), uncompr_size);
+			src_archive.read(src_info->data_offset, resource.get(), uncompr_size);
 			if (src_info->isEncrypted()) {
 				Crypto::rpkgXCrypt(resource.get(), uncompr_size);
 			};
 		}
 
+		if (cache.enabled() || persistent_cache) {
+			auto payload = std::make_shared<const std::vector<char>>(resource.get(), resource.get() + uncompr_size);
+			if (cache.enabled())
+				cache.insert(cache_key, payload);
+			if (persistent_cache)
+				PersistentResourceCache::insertAsync(persistent_cache, context->pool(), persistent_key, std::move(payload));
+		}
+
 		return uncompr_size;
 	}
 
@@ -242,3 +480,63 @@ std::filesystem::path ResourceRepository::runtime_dir = std::filesystem::path();
 		std::copy(data.get(), data.get() + data_size, ret.data());
 		return ret;
 	}
+
+	std::shared_ptr<const ResourceMetadataIndex> RepositorySnapshot::getMetadataIndex() const {
+		std::call_once(metadata_index_flag, [this]() {
+			auto index = std::make_shared<ResourceMetadataIndex>();
+
+			for (const auto& archive : archives)
+				index->archive_names.push_back(archive->name);
+			index->ids.reserve(entries.size());
+			for (const auto& it : entries)
+				index->ids.push_back(it.first);
+			std::sort(index->ids.begin(), index->ids.end(), [](const RuntimeId& a, const RuntimeId& b) { return static_cast<uint64_t>(a) < static_cast<uint64_t>(b); });
+
+			const auto row_count = index->ids.size();
+			index->rows.reserve(row_count);
+			for (uint32_t row = 0; row < row_count; ++row)
+				index->rows[index->ids[row]] = row;
+
+			index->types.resize(row_count);
+			index->archives.resize(row_count);
+			index->compressed_sizes.resize(row_count);
+			index->data_sizes.resize(row_count);
+			index->memory_sizes.resize(row_count);
+			index->video_memory_sizes.resize(row_count);
+			index->reference_counts.resize(row_count);
+			index->reference_offsets.resize(row_count + 1);
+
+			for (size_t row = 0; row < row_count; ++row) {
+				const auto& entry = entries.at(index->ids[row]);
+				const auto* src_info = entry.info;
+				const auto* src_header = entry.header;
+
+				memcpy_s(&index->types[row], sizeof(uint32_t), src_header->type, sizeof(src_header->type));
+				index->archives[row] = static_cast<uint16_t>(entry.archive);
+				index->compressed_sizes[row] = src_info->isCompressed() ? src_info->compressedDataSize() : src_header->data_size;
+				index->data_sizes[row] = src_header->data_size;
+				index->memory_sizes[row] = src_header->memory_size;
+				index->video_memory_sizes[row] = src_header->video_memory_size;
+
+				const auto references = src_header->getReferences();
+				index->reference_counts[row] = static_cast<uint32_t>(references.size());
+				index->reference_offsets[row] = static_cast<uint32_t>(index->reference_rows.size());
+				for (const auto& reference : references) {
+					auto it = index->rows.find(reference.id);
+					index->reference_rows.push_back(it == index->rows.end() ? ResourceMetadataIndex::npos : it->second);
+				}
+			}
+			index->reference_offsets[row_count] = static_cast<uint32_t>(index->reference_rows.size());
+
+			metadata_index = std::move(index);
+		});
+		return metadata_index;
+	}
+
+	std::shared_ptr<const ResourceMetadataIndex> ResourceRepository::getMetadataIndex() const {
+		return snapshot()->getMetadataIndex();
+	}
+
+	std::vector<RuntimeId> ResourceRepository::query(const ResourcePredicate& predicate) const {
+		return runQuery(*getMetadataIndex(), predicate, context->pool());
+	}
@@ -5,8 +5,17 @@
 #include <cinttypes>
 #include <type_traits>
 #include <filesystem>
+#include <fstream>
+#include <memory>
 #include <unordered_map>
+#include <mutex>
+#include <optional>
+#include <algorithm>
 #include "ResourceReference.h"
+#include "ThreadPool.h"
+#include "ResourceCache.h"
+#include "PersistentResourceCache.h"
+#include "Exceptions.h"
 
 namespace GlacierFormats {
 
@@ -62,35 +71,160 @@ namespace GlacierFormats {
 	};
 #pragma pack(pop)
 
-	class ResourceRepositoryData {
-	protected:
-		std::vector<std::ifstream> streams;
-		std::vector<std::string> stream_names;
-		std::vector<std::vector<ResourceInfo>> info_data;
-		std::vector<std::vector<char>> header_data;
+	struct ResourceMetadataIndex;
+	class ResourcePredicate;
 
-		ResourceRepositoryData(const std::filesystem::path& runtime_path);
+	//Index of a single rpkg archive. The index is immutable after construction and shared between repository snapshots,
+	//only the file stream is mutated and all access to it is serialized by read(). The stream is opened on the first read.
+	class ArchiveIndex {
+	public:
+		//Process-wide unique id of this index. Used to key cached payloads, unlike the address it is never reused.
+		const uint64_t serial;
+		const std::filesystem::path path;
+		const std::string name;
+		const uintmax_t file_size;
+		const std::filesystem::file_time_type write_time;
+		//Hash of name, size and last write time. Unlike serial it's stable between runs, used to key the persistent cache.
+		const uint64_t identity;
+
+		std::vector<ResourceInfo> info_data;
+		std::vector<char> header_data;
+
+	private:
+		mutable std::ifstream stream;
+		mutable std::mutex stream_mutex;
+
+	public:
+		//Throws InvalidArgumentsException if the archive is truncated or its index blocks don't fit the file.
+		ArchiveIndex(const std::filesystem::path& path);
+		ArchiveIndex(const ArchiveIndex&) = delete;
+		ArchiveIndex& operator=(const ArchiveIndex&) = delete;
+
+		//Returns true if size and last write time of the file on disk still match the indexed file.
+		[[nodiscard]] bool isUpToDate() const;
+
+		//Reads size bytes starting at offset into dst. Thread-safe.
+		//Throws InvalidArgumentsException if the range isn't part of the file or the file was modified since it was indexed.
+		void read(uint64_t offset, char* dst, size_t size) const;
+	};
+
+	//Resources shared between repository instances: the thread pool used for parallel work and the payload cache.
+	class RepositoryContext {
+	private:
+		std::unique_ptr<ThreadPool> owned_pool;
+		ThreadPool* thread_pool;
+		mutable ResourceCache resource_cache;
+		std::shared_ptr<PersistentResourceCache> persistent_cache;	//Only accessed through std::atomic_load/std::atomic_store
+
+	public:
+		//Uses ThreadPool::defaultPool().
+		explicit RepositoryContext(size_t cache_budget = 0);
+		//Uses a private pool with thread_count threads.
+		RepositoryContext(size_t cache_budget, size_t thread_count);
+		RepositoryContext(const RepositoryContext&) = delete;
+		RepositoryContext& operator=(const RepositoryContext&) = delete;
+
+		//Context of ResourceRepository::instance(). Uses the default pool and has the cache disabled.
+		static std::shared_ptr<RepositoryContext> defaultContext();
+
+		ThreadPool& pool() const noexcept;
+		ResourceCache& cache() const noexcept;
+
+		//Enables the on-disk payload cache in directory. Resources found in it are read without decryption and decompression,
+		//resources that miss are added to it in the background.
+		void enablePersistentCache(const std::filesystem::path& directory);
+		//Returns nullptr if the persistent cache isn't enabled.
+		std::shared_ptr<PersistentResourceCache> persistentCache() const;
+	};
+
+	//Immutable view of the repository at one point in time. Resources in later archives shadow resources with the same
+	//id in earlier archives.
+	class RepositorySnapshot {
+	public:
+		struct Entry {
+			const ResourceInfo* info;
+			const ResourceHeader* header;
+			uint32_t archive;			//Index into archives
+		};
+
+		const std::vector<std::shared_ptr<const ArchiveIndex>> archives;
+		std::unordered_map<RuntimeId, Entry> entries;
+
+	private:
+		mutable std::once_flag metadata_index_flag;
+		mutable std::shared_ptr<const ResourceMetadataIndex> metadata_index;
+
+	public:
+		RepositorySnapshot(std::vector<std::shared_ptr<const ArchiveIndex>> archives);
+		RepositorySnapshot(const RepositorySnapshot&) = delete;
+		RepositorySnapshot& operator=(const RepositorySnapshot&) = delete;
+
+		//Returns nullptr if the snapshot doesn't contain the id.
+		const Entry* find(const RuntimeId& id) const;
+
+		//Built on first access.
+		std::shared_ptr<const ResourceMetadataIndex> getMetadataIndex() const;
+	};
+
+	//Archive names that were added, removed or re-indexed by ResourceRepository::refresh.
+	struct RepositoryRefreshReport {
+		std::vector<std::string> added;
+		std::vector<std::string> removed;
+		std::vector<std::string> changed;
+
+		[[nodiscard]] bool empty() const noexcept;
+	};
+
+	//Outcome of a ResourceRepository::forEachResource sweep. Resources that failed to parse are listed by id together
+	//with the exception message, split into unsupported features and hard failures. Both lists are sorted by id.
+	struct ResourceSweepReport {
+		size_t processed = 0;
+		std::vector<std::pair<RuntimeId, std::string>> unsupported;
+		std::vector<std::pair<RuntimeId, std::string>> failures;
+	};
+
+	template<typename R>
+	struct ResourceSweepResult : public ResourceSweepReport {
+		R value;
 	};
 
 	//Provides transparent read access to repository resource data and references.
-	class ResourceRepository : protected ResourceRepositoryData
+	class ResourceRepository
 	{
 		//This class is optimized for fast construction. Most calculations are off-loaded to access routines.
 		//TODO: The class uses some type punning that's techincally UB. This should be fixed once bit_cast is released with C++20.
+		//All state lives in a RepositorySnapshot. Readers load the current snapshot at the start of every call and keep it alive
+		//until they return, refresh() builds a new snapshot and swaps it in atomically. Readers are never blocked by a refresh.
 	private:
-		std::unordered_map<RuntimeId, const ResourceInfo*> info;
-		std::unordered_map<RuntimeId, const ResourceHeader*> header;
-		mutable std::unordered_map<RuntimeId, std::ifstream*> stream;
+		const std::filesystem::path runtime_path;
+		const std::shared_ptr<RepositoryContext> context;
+		std::shared_ptr<const RepositorySnapshot> current_snapshot;	//Only accessed through std::atomic_load/std::atomic_store
+		std::mutex refresh_mutex;
 
-		ResourceRepository(const std::filesystem::path& runtime_path);
+	public:
+		//Opens the repository in runtime_path. Repositories that share a context share its thread pool and payload cache,
+		//several repositories (e.g. of different game builds) can be open at the same time.
+		explicit ResourceRepository(const std::filesystem::path& runtime_path, std::shared_ptr<RepositoryContext> context = RepositoryContext::defaultContext());
 		ResourceRepository(const ResourceRepository&) = delete;
 		ResourceRepository(ResourceRepository&&) = delete;
 		ResourceRepository& operator=(const ResourceRepository&) = delete;
+		~ResourceRepository();
 
-	public:
 		static std::filesystem::path runtime_dir;
+		//Repository of runtime_dir, shared by all library functions that need repository access.
 		static ResourceRepository* instance();
 
+		const std::shared_ptr<RepositoryContext>& getContext() const noexcept;
+
+		//Current snapshot of the repository. Use a snapshot directly to get a consistent view over several calls.
+		std::shared_ptr<const RepositorySnapshot> snapshot() const;
+
+		//Rescans the runtime directory. Archives that were added or whose size or last write time changed are re-indexed,
+		//unchanged archives are reused. Readers that still hold the previous snapshot keep reading from it.
+		//Archives that can't be indexed, e.g. because they are still being copied, are skipped and retried by the next refresh.
+		//Reads from old snapshots of a since modified archive throw instead of returning data from the wrong offsets.
+		RepositoryRefreshReport refresh();
+
 		[[nodiscard]] bool contains(const RuntimeId& id) const noexcept;
 
 		template<typename T>
@@ -110,6 +244,26 @@ namespace GlacierFormats {
 
 		//Returns the name of the archive file that the resource with the given id is retreived from. 
 		const std::string getSourceStreamName(RuntimeId id) const;
+
+		//Column-wise copy of the repository meta data (types, archives, sizes, references).
+		//The index is built on first access of every snapshot, subsequent calls are free.
+		std::shared_ptr<const ResourceMetadataIndex> getMetadataIndex() const;
+
+		//Returns the ids of all resources that match the predicate, evaluated on the context pool. See ResourceQuery.h for
+		//available predicates.
+		std::vector<RuntimeId> query(const ResourcePredicate& predicate) const;
+
+		//Fetches, decompresses and parses all resources in ids on the thread pool and calls fn(id, resource) for each of them.
+		//If pool is nullptr the pool of the repository context is used.
+		//fn returns a value of type R, the values are combined with reduce(R, R) -> R starting from init. The order of reductions 
+		//is unspecified, reduce has to be associative and commutative. Exceptions thrown while parsing or by fn are caught 
+		//per resource and reported in the result, they don't abort the sweep.
+		template<typename T, typename R, typename Fn, typename Reduce>
+		ResourceSweepResult<R> forEachResource(const std::vector<RuntimeId>& ids, Fn&& fn, Reduce&& reduce, R init, ThreadPool* pool = nullptr) const;
+
+		//Same as above for fn without return value.
+		template<typename T, typename Fn>
+		ResourceSweepReport forEachResource(const std::vector<RuntimeId>& ids, Fn&& fn, ThreadPool* pool = nullptr) const;
 	};
 
 	template<typename T>
@@ -121,4 +275,82 @@ namespace GlacierFormats {
 		return GlacierResource<T>::readFromBuffer(std::move(resource_data), size, id);
 	}
 
+	template<typename T, typename R, typename Fn, typename Reduce>
+	inline ResourceSweepResult<R> ResourceRepository::forEachResource(const std::vector<RuntimeId>& ids, Fn&& fn, Reduce&& reduce, R init, ThreadPool* pool) const {
+		auto& sweep_pool = pool ? *pool : context->pool();
+
+		//Partial results are kept per worker to avoid contention. All threads that aren't workers of pool share the last slot,
+		//the slot mutexes are only contended in that case.
+		struct Partial {
+			std::mutex mutex;
+			std::optional<R> value;
+			ResourceSweepReport report;
+		};
+		std::vector<Partial> partials(sweep_pool.threadCount() + 1);
+
+		sweep_pool.parallelFor(ids.size(), [&](size_t i) {
+			const auto& id = ids[i];
+			std::optional<R> value;
+			std::string error;
+			bool is_unsupported = false;
+			try {
+				auto resource = getResource<T>(id);
+				if (!resource)
+					throw InvalidArgumentsException("Resource not found in repository");
+				value.emplace(fn(id, *resource));
+			}
+			catch (const UnsupportedFeatureException& e) {
+				is_unsupported = true;
+				error = e.what();
+			}
+			catch (const std::exception& e) {
+				error = e.what();
+			}
+			catch (const char* e) {
+				error = e;
+			}
+			catch (...) {
+				error = "Unknown exception";
+			}
+
+			auto& partial = partials[sweep_pool.currentWorkerIndex()];
+			std::lock_guard<std::mutex> lock(partial.mutex);
+			if (value) {
+				++partial.report.processed;
+				if (partial.value)
+					partial.value.emplace(reduce(std::move(*partial.value), std::move(*value)));
+				else
+					partial.value = std::move(value);
+			}
+			else if (is_unsupported)
+				partial.report.unsupported.emplace_back(id, std::move(error));
+			else
+				partial.report.failures.emplace_back(id, std::move(error));
+		});
+
+		ResourceSweepResult<R> result;
+		result.value = std::move(init);
+		for (auto& partial : partials) {
+			if (partial.value)
+				result.value = reduce(std::move(result.value), std::move(*partial.value));
+			result.processed += partial.report.processed;
+			result.unsupported.insert(result.unsupported.end(), partial.report.unsupported.begin(), partial.report.unsupported.end());
+			result.failures.insert(result.failures.end(), partial.report.failures.begin(), partial.report.failures.end());
+		}
+
+		auto by_id = [](const auto& a, const auto& b) { return static_cast<uint64_t>(a.first) < static_cast<uint64_t>(b.first); };
+		std::sort(result.unsupported.begin(), result.unsupported.end(), by_id);
+		std::sort(result.failures.begin(), result.failures.end(), by_id);
+		return result;
+	}
+
+	template<typename T, typename Fn>
+	inline ResourceSweepReport ResourceRepository::forEachResource(const std::vector<RuntimeId>& ids, Fn&& fn, ThreadPool* pool) const {
+		auto result = forEachResource<T>(ids, 
+			[&fn](const RuntimeId& id, T& resource) { fn(id, resource); return 0; },
+			[](int, int) { return 0; }, 
+			0, pool);
+		return std::move(static_cast<ResourceSweepReport&>(result));
+	}
+
 }
\ No newline at end of file
@@ -118,7 +118,7 @@ TextureResource<T>::TextureResource(const TextureResource& other) :
 
 template<typename T>
 TextureResource<T>::TextureResource(BinaryReader& br, RuntimeId id) : GlacierResource<T>(id){
-	header = br.read<TextureHeader>();
+	header = TextureHeaderLayout::read(br);
 
 	if (header.texture_atlas_data_size) {
 		texture_atlas_data.resize(header.texture_atlas_data_size);
@@ -471,8 +471,14 @@ bool TextureResource<T>::saveToPNGFile(const std::filesystem::path& path) const
 
 template<typename T>
 void TextureResource<T>::serialize(BinaryWriter& bw) {
-	bw.write(header);
-	bw.write(pixels.data(), pixels.size());
+	bw.reserve(serializedSize());
+	TextureHeaderLayout::write(bw, header);
+	bw.writeReference(pixels.data(), pixels.size());
+}
+
+template<typename T>
+int64_t TextureResource<T>::serializedSize() const {
+	return TextureHeaderLayout::size + pixels.size();
 }
 
 
@@ -624,6 +630,7 @@ template bool TextureResource<TEXD>::saveToDDSFile(const std::filesystem::path&
 template bool TextureResource<TEXD>::saveToTGAFile(const std::filesystem::path& dir) const;
 template bool TextureResource<TEXD>::saveToPNGFile(const std::filesystem::path& path) const;
 template void TextureResource<TEXD>::serialize(BinaryWriter& bw);
+template int64_t TextureResource<TEXD>::serializedSize() const;
 template std::unique_ptr<TEXD> TextureResource<TEXD>::loadFromTGAFile(const std::filesystem::path& path);
 template std::unique_ptr<TEXD> TextureResource<TEXD>::loadFromPNGFile(const std::filesystem::path& path);
 
@@ -637,6 +644,7 @@ template bool TextureResource<TEXT>::saveToDDSFile(const std::filesystem::path&
 template bool TextureResource<TEXT>::saveToTGAFile(const std::filesystem::path& dir) const;
 template bool TextureResource<TEXT>::saveToPNGFile(const std::filesystem::path& path) const;
 template void TextureResource<TEXT>::serialize(BinaryWriter& bw);
+template int64_t TextureResource<TEXT>::serializedSize() const;
 template std::unique_ptr<TEXT> TextureResource<TEXT>::loadFromTGAFile(const std::filesystem::path& path);
 template std::unique_ptr<TEXT> TextureResource<TEXT>::loadFromPNGFile(const std::filesystem::path& path);
 
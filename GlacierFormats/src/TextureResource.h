@@ -3,6 +3,7 @@
 #include "..\thirdparty\DirectXTex-master\DirectXTex\DirectXTex.h"
 #include "..\thirdparty\DirectXTex-master\DirectXTex\DDS.h"
 #include "GlacierResource.h"
+#include "BinaryLayout.h"
 
 namespace GlacierFormats {
 
@@ -52,6 +53,25 @@ namespace GlacierFormats {
 	};
 #pragma pack(pop)
 
+	using TextureHeaderLayout = BinaryLayout<TextureHeader,
+		Field<&TextureHeader::magic>,
+		Field<&TextureHeader::type>,
+		Field<&TextureHeader::file_size>,
+		Field<&TextureHeader::flags>,
+		Field<&TextureHeader::width>,
+		Field<&TextureHeader::height>,
+		Field<&TextureHeader::format>,
+		Field<&TextureHeader::mips_cnt>,
+		Field<&TextureHeader::default_mip>,
+		Field<&TextureHeader::interpret_as>,
+		Field<&TextureHeader::dimensions>,
+		Field<&TextureHeader::mips_interpol_mode>,
+		Field<&TextureHeader::mips_data_sizes>,
+		Field<&TextureHeader::mips_data_sizes_dup>,
+		Field<&TextureHeader::texture_atlas_data_size>,
+		Field<&TextureHeader::texture_atlas_data_offset>>;
+	static_assert(TextureHeaderLayout::is_memory_layout);
+
 	template<typename T>
 	class TextureResource : public GlacierResource<T> {
 	public:
@@ -64,6 +84,7 @@ namespace GlacierFormats {
 		TextureResource(BinaryReader& br, RuntimeId id);
 
 		void serialize(BinaryWriter& bw);
+		int64_t serializedSize() const;
 
 		std::string name() const;
 
@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace GlacierFormats;
+
+namespace {
+	thread_local const ThreadPool* current_pool = nullptr;
+	thread_local size_t current_worker_index = 0;
+}
+
+	ThreadPool::ThreadPool(size_t thread_count) : pending_tasks(0), next_queue(0), stop(false) {
+		if (thread_count == 0)
+			thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+		for (size_t i = 0; i < thread_count; ++i)
+			queues.push_back(std::make_unique<Queue>());
+
+		threads.reserve(thread_count);
+		for (size_t i = 0; i < thread_count; ++i)
+			threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			stop = true;
+		}
+		sleep_cv.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	ThreadPool& ThreadPool::defaultPool() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	size_t ThreadPool::threadCount() const noexcept {
+		//queues is complete before the first worker starts, threads is still growing during construction.
+		return queues.size();
+	}
+
+	size_t ThreadPool::currentWorkerIndex() const noexcept {
+		if (current_pool == this)
+			return current_worker_index;
+		return threadCount();
+	}
+
+	void ThreadPool::submit(Task task) {
+		//Workers push to their own queue to keep nested tasks local, other threads distribute round robin.
+		auto queue_index = currentWorkerIndex();
+		if (queue_index == threadCount())
+			queue_index = next_queue++ % queues.size();
+
+		//Count the task before it becomes visible so that pending_tasks never underflows.
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			++pending_tasks;
+		}
+		{
+			std::lock_guard<std::mutex> lock(queues[queue_index]->mutex);
+			queues[queue_index]->tasks.push_back(std::move(task));
+		}
+		sleep_cv.notify_one();
+	}
+
+	bool ThreadPool::tryPop(size_t queue_index, Task& task) {
+		auto& queue = *queues[queue_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			return false;
+		task = std::move(queue.tasks.back());
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool ThreadPool::trySteal(size_t thief_index, Task& task) {
+		for (size_t i = 1; i <= queues.size(); ++i) {
+			auto& queue = *queues[(thief_index + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				continue;
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+		return false;
+	}
+
+	bool ThreadPool::runPendingTask() {
+		Task task;
+		const auto worker_index = currentWorkerIndex();
+		const bool is_worker = worker_index != threadCount();
+		if (!(is_worker && tryPop(worker_index, task)) && !trySteal(worker_index, task))
+			return false;
+
+		--pending_tasks;
+		task();
+		return true;
+	}
+
+	void ThreadPool::workerLoop(size_t worker_index) {
+		current_pool = this;
+		current_worker_index = worker_index;
+
+		while (true) {
+			if (runPendingTask())
+				continue;
+
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			sleep_cv.wait(lock, [this]() { return stop || pending_tasks.load() != 0; });
+			if (stop && pending_tasks.load() == 0)
+				return;
+		}
+	}
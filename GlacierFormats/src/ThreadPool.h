@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <exception>
+
+namespace GlacierFormats {
+
+	//Work-stealing thread pool. Every worker owns a task queue, idle workers steal from the other queues.
+	//Threads that wait on a parallelFor help executing queued tasks, so parallelFor can be nested.
+	class ThreadPool {
+	public:
+		using Task = std::function<void()>;
+
+	private:
+		struct Queue {
+			std::deque<Task> tasks;
+			std::mutex mutex;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> threads;
+
+		std::mutex sleep_mutex;
+		std::condition_variable sleep_cv;
+		std::atomic<size_t> pending_tasks;
+		std::atomic<size_t> next_queue;
+		bool stop;
+
+		void workerLoop(size_t worker_index);
+		bool tryPop(size_t queue_index, Task& task);
+		bool trySteal(size_t thief_index, Task& task);
+
+	public:
+		//thread_count == 0 uses one thread per hardware thread.
+		explicit ThreadPool(size_t thread_count = 0);
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+
+		//Pool shared by all library functions that don't get a pool passed explicitly.
+		static ThreadPool& defaultPool();
+
+		size_t threadCount() const noexcept;
+
+		//Returns the index of the worker thread of this pool that calls the function or threadCount() for other threads.
+		size_t currentWorkerIndex() const noexcept;
+
+		void submit(Task task);
+
+		//Runs one queued task on the calling thread. Returns false if no task was available.
+		bool runPendingTask();
+
+		//Calls fn(i) for all i in [0, count) and blocks until all calls returned. The calling thread runs queued tasks until
+		//none is left and then sleeps until the remaining calls finished on other threads.
+		//The first exception thrown by fn is rethrown after all calls finished.
+		template<typename Fn>
+		void parallelFor(size_t count, Fn&& fn);
+	};
+
+	template<typename Fn>
+	inline void ThreadPool::parallelFor(size_t count, Fn&& fn) {
+		if (count == 0)
+			return;
+
+		std::atomic<size_t> remaining(count);
+		std::exception_ptr first_exception = nullptr;
+		std::mutex exception_mutex;
+		//Set by the last finished call. The caller only returns after observing it under done_mutex, so no task touches
+		//the locals of this frame after it returned.
+		bool done = false;
+		std::mutex done_mutex;
+		std::condition_variable done_cv;
+
+		for (size_t i = 0; i < count; ++i) {
+			submit([&, i]() {
+				try {
+					fn(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(exception_mutex);
+					if (!first_exception)
+						first_exception = std::current_exception();
+				}
+				if (--remaining == 0) {
+					std::lock_guard<std::mutex> lock(done_mutex);
+					done = true;
+					done_cv.notify_all();
+				}
+			});
+		}
+
+		//Once no queued task is left all calls of fn are running on other threads, wait for them instead of spinning.
+		while (remaining.load() != 0 && runPendingTask()) {}
+
+		{
+			std::unique_lock<std::mutex> lock(done_mutex);
+			done_cv.wait(lock, [&done]() { return done; });
+		}
+
+		if (first_exception)
+			std::rethrow_exception(first_exception);
+	}
+
+}
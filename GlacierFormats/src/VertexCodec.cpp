@@ -0,0 +1,358 @@
+#include "VertexCodec.h"
+#include "IntegerRangeCompression.h"
+#include <atomic>
+#include <limits>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define GLACIER_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//MSVC allows AVX2 intrinsics in any function, GCC and Clang need them to be enabled per function.
+#if defined(__GNUC__) || defined(__clang__)
+#define GLACIER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GLACIER_TARGET_AVX2
+#endif
+
+using namespace GlacierFormats;
+
+namespace {
+
+	SimdLevel detectSimdLevel() noexcept {
+#if GLACIER_SIMD_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7) {
+			__cpuid(info, 1);
+			const bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+			__cpuidex(info, 7, 0);
+			const bool avx2 = (info[1] & (1 << 5)) != 0;
+			if (os_saves_ymm && avx2)
+				return SimdLevel::AVX2;
+		}
+#else
+		if (__builtin_cpu_supports("avx2"))
+			return SimdLevel::AVX2;
+#endif
+		return SimdLevel::SSE2;
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	const SimdLevel supported_simd_level = detectSimdLevel();
+	std::atomic<SimdLevel> active_simd_level = supported_simd_level;
+
+	constexpr float short_max = std::numeric_limits<short>::max();
+
+	void decodePositionsScalar(const int16_t* src, float* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		for (size_t i = 0; i < 4 * count; ++i)
+			dst[i] = IntegerRangeCompressor<short, float>::decompress(src[i], scale[i % 4], bias[i % 4]);
+	}
+
+	void decodeVertexDataScalar(const uint8_t* src, size_t count, float* normals, float* tangents, float* bitangents, float* uvs,
+		const float uv_scale[2], const float uv_bias[2], bool flip_v) noexcept {
+		for (size_t i = 0; i < count; ++i) {
+			const uint8_t* record = src + i * VertexCodec::vertex_data_record_size;
+			for (int j = 0; j < 4; ++j) {
+				if (normals)
+					normals[4 * i + j] = VertexCodec::decompress8BitFloat(record[j]);
+				if (tangents)
+					tangents[4 * i + j] = VertexCodec::decompress8BitFloat(record[4 + j]);
+				if (bitangents)
+					bitangents[4 * i + j] = VertexCodec::decompress8BitFloat(record[8 + j]);
+			}
+
+			if (!uvs)
+				continue;
+			int16_t uv[2];
+			std::memcpy(uv, record + 12, sizeof(uv));
+			uvs[2 * i + 0] = IntegerRangeCompressor<short, float>::decompress(uv[0], uv_scale[0], uv_bias[0]);
+			uvs[2 * i + 1] = IntegerRangeCompressor<short, float>::decompress(uv[1], uv_scale[1], uv_bias[1]);
+			if (flip_v)
+				uvs[2 * i + 1] *= -1.0f;
+		}
+	}
+
+	void encodePositionsScalar(const float* src, int16_t* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		for (size_t i = 0; i < count; ++i) {
+			for (int j = 0; j < 3; ++j)
+				dst[4 * i + j] = IntegerRangeCompressor<short, float>::compress(src[4 * i + j], scale[j], bias[j]);
+			dst[4 * i + 3] = 0x7FFF;
+		}
+	}
+
+	void encodeVertexDataScalar(const float* normals, const float* tangents, const float* bitangents, const float* uvs, size_t count,
+		uint8_t* dst, const float uv_scale[2], const float uv_bias[2]) noexcept {
+		for (size_t i = 0; i < count; ++i) {
+			uint8_t* record = dst + i * VertexCodec::vertex_data_record_size;
+			for (int j = 0; j < 4; ++j) {
+				record[j] = VertexCodec::compress8BitFloat(normals[4 * i + j]);
+				record[4 + j] = VertexCodec::compress8BitFloat(tangents[4 * i + j]);
+			}
+			for (int j = 0; j < 3; ++j)
+				record[8 + j] = VertexCodec::compress8BitFloat(bitangents[4 * i + j]);
+			record[11] = VertexCodec::compress8BitFloat(0.0f);
+
+			const int16_t uv[2] = {
+				IntegerRangeCompressor<short, float>::compress(uvs[2 * i + 0], uv_scale[0], uv_bias[0]),
+				IntegerRangeCompressor<short, float>::compress(uvs[2 * i + 1], uv_scale[1], uv_bias[1])
+			};
+			std::memcpy(record + 12, uv, sizeof(uv));
+		}
+	}
+
+#if GLACIER_SIMD_X86
+
+	//Same operation order as IntegerRangeCompressor::decompress: ((float)i * scale) / max + bias.
+	inline __m128 decompress4(__m128i ints, __m128 scale, __m128 bias) noexcept {
+		return _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(ints), scale), _mm_set1_ps(short_max)), bias);
+	}
+
+	void decodePositionsSSE2(const int16_t* src, float* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		const __m128 s = _mm_loadu_ps(scale);
+		const __m128 b = _mm_loadu_ps(bias);
+
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2) {
+			const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+			//Sign extend int16 to int32 by interleaving with itself and shifting back.
+			const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+			const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+			_mm_storeu_ps(dst + 4 * i, decompress4(lo, s, b));
+			_mm_storeu_ps(dst + 4 * i + 4, decompress4(hi, s, b));
+		}
+		decodePositionsScalar(src + 4 * i, dst + 4 * i, count - i, scale, bias);
+	}
+
+	//Same operation order as VertexCodec::decompress8BitFloat: 2.0 * (float)b / 255.0 - 1.0.
+	inline __m128 decompress8BitFloat4(__m128i ints) noexcept {
+		const __m128 doubled = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_cvtepi32_ps(ints));
+		return _mm_sub_ps(_mm_div_ps(doubled, _mm_set1_ps(255.0f)), _mm_set1_ps(1.0f));
+	}
+
+	void decodeVertexDataSSE2(const uint8_t* src, size_t count, float* normals, float* tangents, float* bitangents, float* uvs,
+		const float uv_scale[2], const float uv_bias[2], bool flip_v) noexcept {
+		const __m128i zero = _mm_setzero_si128();
+		//The uvs occupy the upper two int32 lanes after sign extension, the lower two lanes are ignored.
+		const __m128 s = _mm_setr_ps(1.0f, 1.0f, uv_scale[0], uv_scale[1]);
+		const __m128 b = _mm_setr_ps(0.0f, 0.0f, uv_bias[0], uv_bias[1]);
+		const __m128 flip = _mm_setr_ps(1.0f, 1.0f, 1.0f, flip_v ? -1.0f : 1.0f);
+
+		for (size_t i = 0; i < count; ++i) {
+			const __m128i record = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * VertexCodec::vertex_data_record_size));
+
+			//Zero extend the tangent frame bytes to int32.
+			const __m128i bytes_lo = _mm_unpacklo_epi8(record, zero);
+			const __m128i bytes_hi = _mm_unpackhi_epi8(record, zero);
+			if (normals)
+				_mm_storeu_ps(normals + 4 * i, decompress8BitFloat4(_mm_unpacklo_epi16(bytes_lo, zero)));
+			if (tangents)
+				_mm_storeu_ps(tangents + 4 * i, decompress8BitFloat4(_mm_unpackhi_epi16(bytes_lo, zero)));
+			if (bitangents)
+				_mm_storeu_ps(bitangents + 4 * i, decompress8BitFloat4(_mm_unpacklo_epi16(bytes_hi, zero)));
+			if (!uvs)
+				continue;
+
+			//Sign extend the int16 uvs to int32.
+			const __m128i uv_ints = _mm_srai_epi32(_mm_unpackhi_epi16(record, record), 16);
+			__m128 uv = decompress4(uv_ints, s, b);
+			uv = _mm_mul_ps(uv, flip);
+			_mm_storeh_pi(reinterpret_cast<__m64*>(uvs + 2 * i), uv);
+		}
+	}
+
+	//Rounds half away from zero like std::round and converts to int32. Values outside of the int32 range convert to
+	//0x80000000 like the scalar conversion does on x86.
+	inline __m128i roundToInt4(__m128 x) noexcept {
+		const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128i truncated = _mm_cvttps_epi32(x);
+		const __m128 remainder = _mm_and_ps(_mm_sub_ps(x, _mm_cvtepi32_ps(truncated)), abs_mask);
+		const __m128 in_range = _mm_cmplt_ps(_mm_and_ps(x, abs_mask), _mm_set1_ps(2147483648.0f));
+		const __m128i round_away = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(remainder, _mm_set1_ps(0.5f)), in_range));
+		//-1 for negative values, +1 otherwise.
+		const __m128i direction = _mm_or_si128(_mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())), _mm_set1_epi32(1));
+		return _mm_add_epi32(truncated, _mm_and_si128(round_away, direction));
+	}
+
+	//Double precision variant of roundToInt4 for two values. The results are in the lower two int32 lanes.
+	inline __m128i roundToInt2(__m128d x) noexcept {
+		const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+		const __m128i truncated = _mm_cvttpd_epi32(x);
+		const __m128d remainder = _mm_and_pd(_mm_sub_pd(x, _mm_cvtepi32_pd(truncated)), abs_mask);
+		const __m128d in_range = _mm_cmplt_pd(_mm_and_pd(x, abs_mask), _mm_set1_pd(2147483648.0));
+		const __m128d round_away = _mm_and_pd(_mm_cmpge_pd(remainder, _mm_set1_pd(0.5)), in_range);
+		const __m128d negative = _mm_cmplt_pd(x, _mm_setzero_pd());
+		//Narrow the 64 bit masks to the lower two 32 bit lanes.
+		const __m128i round_away32 = _mm_shuffle_epi32(_mm_castpd_si128(round_away), _MM_SHUFFLE(3, 3, 2, 0));
+		const __m128i direction = _mm_or_si128(_mm_shuffle_epi32(_mm_castpd_si128(negative), _MM_SHUFFLE(3, 3, 2, 0)), _mm_set1_epi32(1));
+		return _mm_add_epi32(truncated, _mm_and_si128(_mm_and_si128(round_away32, direction), _mm_set_epi32(0, 0, -1, -1)));
+	}
+
+	//Same operation order as IntegerRangeCompressor::compress: round(max * (f - bias) / scale).
+	inline __m128i compress4(__m128 f, __m128 scale, __m128 bias) noexcept {
+		return roundToInt4(_mm_div_ps(_mm_mul_ps(_mm_set1_ps(short_max), _mm_sub_ps(f, bias)), scale));
+	}
+
+	//Same operation order as VertexCodec::compress8BitFloat: round((f + 1.0) / 2.0 * 255.0) in double precision.
+	inline __m128i compress8BitFloat4(__m128 f) noexcept {
+		auto compress2 = [](__m128d d) {
+			return roundToInt2(_mm_mul_pd(_mm_div_pd(_mm_add_pd(d, _mm_set1_pd(1.0)), _mm_set1_pd(2.0)), _mm_set1_pd(255.0)));
+		};
+		const __m128i lo = compress2(_mm_cvtps_pd(f));
+		const __m128i hi = compress2(_mm_cvtps_pd(_mm_movehl_ps(f, f)));
+		return _mm_unpacklo_epi64(lo, hi);
+	}
+
+	//Truncates int32 lanes to their lower 16 bits like the scalar narrowing conversion.
+	inline __m128i truncateToInt16(__m128i lo, __m128i hi) noexcept {
+		return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16), _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+	}
+
+	void encodePositionsSSE2(const float* src, int16_t* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		//The w lane is computed with a neutral scale and replaced afterwards.
+		const __m128 s = _mm_setr_ps(scale[0], scale[1], scale[2], 1.0f);
+		const __m128 b = _mm_setr_ps(bias[0], bias[1], bias[2], 0.0f);
+		const __m128i w_mask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+		const __m128i w = _mm_set1_epi16(0x7FFF);
+
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2) {
+			const __m128i lo = compress4(_mm_loadu_ps(src + 4 * i), s, b);
+			const __m128i hi = compress4(_mm_loadu_ps(src + 4 * i + 4), s, b);
+			__m128i packed = truncateToInt16(lo, hi);
+			packed = _mm_or_si128(_mm_andnot_si128(w_mask, packed), _mm_and_si128(w_mask, w));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), packed);
+		}
+		encodePositionsScalar(src + 4 * i, dst + 4 * i, count - i, scale, bias);
+	}
+
+	void encodeVertexDataSSE2(const float* normals, const float* tangents, const float* bitangents, const float* uvs, size_t count,
+		uint8_t* dst, const float uv_scale[2], const float uv_bias[2]) noexcept {
+		const __m128 uv_s = _mm_setr_ps(uv_scale[0], uv_scale[1], 1.0f, 1.0f);
+		const __m128 uv_b = _mm_setr_ps(uv_bias[0], uv_bias[1], 0.0f, 0.0f);
+		const __m128 bitangent_w_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+		for (size_t i = 0; i < count; ++i) {
+			const __m128i normal = compress8BitFloat4(_mm_loadu_ps(normals + 4 * i));
+			const __m128i tangent = compress8BitFloat4(_mm_loadu_ps(tangents + 4 * i));
+			const __m128i bitangent = compress8BitFloat4(_mm_and_ps(_mm_loadu_ps(bitangents + 4 * i), bitangent_w_mask));
+			const __m128i uv = compress4(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(uvs + 2 * i))), uv_s, uv_b);
+
+			//The tangent frame values are in [0, 255] for normalized input, keep their lower 8 bits like the scalar conversion.
+			const __m128i byte_mask = _mm_set1_epi32(0xFF);
+			const __m128i frame_lo = _mm_packs_epi32(_mm_and_si128(normal, byte_mask), _mm_and_si128(tangent, byte_mask));
+			const __m128i frame_hi = _mm_packs_epi32(_mm_and_si128(bitangent, byte_mask), _mm_setzero_si128());
+			__m128i record = _mm_packus_epi16(frame_lo, frame_hi);
+
+			//Insert the two int16 uvs into the last four bytes.
+			const __m128i uv16 = truncateToInt16(uv, _mm_setzero_si128());
+			record = _mm_insert_epi16(record, _mm_extract_epi16(uv16, 0), 6);
+			record = _mm_insert_epi16(record, _mm_extract_epi16(uv16, 1), 7);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * VertexCodec::vertex_data_record_size), record);
+		}
+	}
+
+	GLACIER_TARGET_AVX2 void decodePositionsAVX2(const int16_t* src, float* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		const __m128 s4 = _mm_loadu_ps(scale);
+		const __m128 b4 = _mm_loadu_ps(bias);
+		const __m256 s = _mm256_insertf128_ps(_mm256_castps128_ps256(s4), s4, 1);
+		const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(b4), b4, 1);
+		const __m256 max = _mm256_set1_ps(short_max);
+
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128i packed_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+			const __m128i packed_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i + 8));
+			const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed_lo));
+			const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed_hi));
+			_mm256_storeu_ps(dst + 4 * i, _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(lo, s), max), b));
+			_mm256_storeu_ps(dst + 4 * i + 8, _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(hi, s), max), b));
+		}
+		decodePositionsSSE2(src + 4 * i, dst + 4 * i, count - i, scale, bias);
+	}
+
+#endif
+
+}
+
+	SimdLevel GlacierFormats::supportedSimdLevel() noexcept {
+		return supported_simd_level;
+	}
+
+	SimdLevel GlacierFormats::activeSimdLevel() noexcept {
+		return active_simd_level.load(std::memory_order_relaxed);
+	}
+
+	void GlacierFormats::setSimdLevel(SimdLevel level) noexcept {
+		if (static_cast<int>(level) > static_cast<int>(supported_simd_level))
+			level = supported_simd_level;
+		active_simd_level.store(level, std::memory_order_relaxed);
+	}
+
+	void VertexCodec::decodePositions(const int16_t* src, float* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		switch (activeSimdLevel()) {
+#if GLACIER_SIMD_X86
+		case SimdLevel::AVX2:
+			decodePositionsAVX2(src, dst, count, scale, bias);
+			return;
+		case SimdLevel::SSE2:
+			decodePositionsSSE2(src, dst, count, scale, bias);
+			return;
+#endif
+		default:
+			decodePositionsScalar(src, dst, count, scale, bias);
+			return;
+		}
+	}
+
+	void VertexCodec::decodeVertexData(const uint8_t* src, size_t count, float* normals, float* tangents, float* bitangents, float* uvs,
+		const float uv_scale[2], const float uv_bias[2], bool flip_v) noexcept {
+		//The records are decoded with SSE2 on AVX2 machines as well, the decoder is bound by the stores.
+		switch (activeSimdLevel()) {
+#if GLACIER_SIMD_X86
+		case SimdLevel::AVX2:
+		case SimdLevel::SSE2:
+			decodeVertexDataSSE2(src, count, normals, tangents, bitangents, uvs, uv_scale, uv_bias, flip_v);
+			return;
+#endif
+		default:
+			decodeVertexDataScalar(src, count, normals, tangents, bitangents, uvs, uv_scale, uv_bias, flip_v);
+			return;
+		}
+	}
+
+	void VertexCodec::encodePositions(const float* src, int16_t* dst, size_t count, const float scale[4], const float bias[4]) noexcept {
+		switch (activeSimdLevel()) {
+#if GLACIER_SIMD_X86
+		case SimdLevel::AVX2:
+		case SimdLevel::SSE2:
+			encodePositionsSSE2(src, dst, count, scale, bias);
+			return;
+#endif
+		default:
+			encodePositionsScalar(src, dst, count, scale, bias);
+			return;
+		}
+	}
+
+	void VertexCodec::encodeVertexData(const float* normals, const float* tangents, const float* bitangents, const float* uvs, size_t count,
+		uint8_t* dst, const float uv_scale[2], const float uv_bias[2]) noexcept {
+		switch (activeSimdLevel()) {
+#if GLACIER_SIMD_X86
+		case SimdLevel::AVX2:
+		case SimdLevel::SSE2:
+			encodeVertexDataSSE2(normals, tangents, bitangents, uvs, count, dst, uv_scale, uv_bias);
+			return;
+#endif
+		default:
+			encodeVertexDataScalar(normals, tangents, bitangents, uvs, count, dst, uv_scale, uv_bias);
+			return;
+		}
+	}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+namespace GlacierFormats {
+
+	//Instruction sets used by the bulk vertex codecs.
+	enum class SimdLevel {
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+	//Highest instruction set supported by the CPU.
+	SimdLevel supportedSimdLevel() noexcept;
+
+	//Instruction set used by the bulk vertex codecs. Defaults to supportedSimdLevel().
+	SimdLevel activeSimdLevel() noexcept;
+
+	//Selects the instruction set used by the bulk vertex codecs, clamped to supportedSimdLevel(). Intended for tests and
+	//benchmarks, all levels produce bit-identical results.
+	void setSimdLevel(SimdLevel level) noexcept;
+
+	//Bulk decoders and encoders for PRIM vertex streams. All functions produce results that are bit-identical to the
+	//per-element IntegerRangeCompressor code regardless of the active SimdLevel.
+	namespace VertexCodec {
+
+		//Size of a serialized vertex data record: normal, tangent and bitangent as uint8x4 followed by the uv as int16x2.
+		constexpr size_t vertex_data_record_size = 0x10;
+
+		//Maps [0, 255] to [-1, 1].
+		inline float decompress8BitFloat(uint8_t b) noexcept {
+			return 2.0f * static_cast<float>(b) / 255.0f - 1.0f;
+		}
+
+		//Maps [-1, 1] to [0, 255]. Evaluated in double precision like the original encoder.
+		inline uint8_t compress8BitFloat(float f) noexcept {
+			return static_cast<uint8_t>(std::round((f + 1.0) / 2.0 * 255.0));
+		}
+
+		//Decompresses count int16x4 positions from src into count float4 positions in dst with per component scale and bias.
+		void decodePositions(const int16_t* src, float* dst, size_t count, const float scale[4], const float bias[4]) noexcept;
+
+		//Decodes count vertex data records from src into float4 normals, tangents and bitangents and float2 uvs.
+		//flip_v negates the v coordinate of the uvs like IMesh::getUVs expects it. Streams passed as nullptr are skipped.
+		void decodeVertexData(const uint8_t* src, size_t count, float* normals, float* tangents, float* bitangents, float* uvs,
+			const float uv_scale[2], const float uv_bias[2], bool flip_v = false) noexcept;
+
+		//Compresses the xyz components of count float4 positions from src into count int16x4 records in dst. The w component 
+		//is always written as 0x7FFF.
+		void encodePositions(const float* src, int16_t* dst, size_t count, const float scale[4], const float bias[4]) noexcept;
+
+		//Encodes count float4 normals, tangents and bitangents and float2 uvs into vertex data records in dst. The w component
+		//of the bitangents is ignored and always written as 0.
+		void encodeVertexData(const float* normals, const float* tangents, const float* bitangents, const float* uvs, size_t count,
+			uint8_t* dst, const float uv_scale[2], const float uv_bias[2]) noexcept;
+
+	}
+
+}
@@ -0,0 +1,169 @@
+#include "GlacierFormats.h"
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace GlacierFormats;
+
+//Measures parsing and serialization performance of resources loaded from the repository.
+//All resource data is decompressed up front, the timings only cover the code paths under test.
+//Usage: GFSample_Benchmark [max_resource_count]
+
+struct ResourceData {
+	RuntimeId id;
+	std::vector<char> data;
+};
+
+template<typename Fn>
+double measureMilliseconds(Fn&& fn) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	fn();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+std::vector<ResourceData> loadResources(const std::string& type, size_t max_count) {
+	auto repo = ResourceRepository::instance();
+	auto ids = repo->getIdsByType(type);
+	if (ids.size() > max_count)
+		ids.resize(max_count);
+
+	std::vector<ResourceData> resources;
+	resources.reserve(ids.size());
+	for (const auto& id : ids)
+		resources.push_back({ id, repo->getResource(id) });
+	return resources;
+}
+
+//Parses all resources with the given reader type. Returns the number of resources that were parsed successfully.
+template<typename Reader, typename MakeReader>
+size_t parsePrims(const std::vector<ResourceData>& resources, MakeReader&& make_reader) {
+	size_t parsed = 0;
+	for (const auto& resource : resources) {
+		Reader br = make_reader(resource.data);
+		try {
+			PRIM prim(br, resource.id);
+			++parsed;
+		}
+		catch (const UnsupportedFeatureException&) {
+			continue;
+		}
+	}
+	return parsed;
+}
+
+void printResult(const std::string& name, double ms, size_t count) {
+	printf("%-40s %10.2f ms (%zu resources)\n", name.c_str(), ms, count);
+}
+
+//Serializes all resources repeatedly. With an arena, released buffers are recycled and reused by the following writers.
+template<typename T>
+size_t serializeResources(const std::vector<std::unique_ptr<T>>& resources, int iterations, BinaryWriterBufferArena* arena) {
+	size_t bytes = 0;
+	for (int i = 0; i < iterations; ++i) {
+		for (const auto& resource : resources) {
+			BinaryWriter bw(0, arena);
+			resource->serialize(bw);
+			auto buffer = bw.release();
+			bytes += buffer.size();
+			if (arena)
+				arena->recycle(std::move(buffer));
+		}
+	}
+	return bytes;
+}
+
+template<typename T>
+void benchmarkSerialization(const std::string& type, const std::vector<ResourceData>& resources) {
+	constexpr int iterations = 4;
+
+	std::vector<std::unique_ptr<T>> parsed;
+	for (const auto& resource : resources) {
+		try {
+			parsed.push_back(GlacierResource<T>::readFromBuffer(resource.data, resource.id));
+		}
+		catch (const UnsupportedFeatureException&) {
+			continue;
+		}
+	}
+
+	auto ms = measureMilliseconds([&]() { serializeResources(parsed, iterations, nullptr); });
+	printResult(type + " serialize", ms, iterations * parsed.size());
+
+	BinaryWriterBufferArena arena;
+	ms = measureMilliseconds([&]() { serializeResources(parsed, iterations, &arena); });
+	printResult(type + " serialize, arena", ms, iterations * parsed.size());
+}
+
+//Parses the largest meshes once per SIMD level of the bulk vertex codecs. Large PRIMs are dominated by vertex decoding.
+void benchmarkVertexDecode(size_t max_count) {
+	constexpr int iterations = 4;
+	constexpr uint32_t min_data_size = 0x100000;
+
+	auto repo = ResourceRepository::instance();
+	auto ids = repo->query(query::type("PRIM") && query::dataSize() > min_data_size);
+	if (ids.size() > max_count)
+		ids.resize(max_count);
+
+	std::vector<ResourceData> prims;
+	for (const auto& id : ids)
+		prims.push_back({ id, repo->getResource(id) });
+
+	const char* level_names[] = { "Scalar", "SSE2", "AVX2" };
+	for (auto level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+		if (static_cast<int>(level) > static_cast<int>(supportedSimdLevel()))
+			continue;
+		setSimdLevel(level);
+
+		size_t parsed = 0;
+		auto ms = measureMilliseconds([&]() {
+			for (int i = 0; i < iterations; ++i)
+				parsed += parsePrims<SpanBinaryReader>(prims, [](const std::vector<char>& data) { return SpanBinaryReader(BinaryReaderSpanSource(data.data(), data.size())); });
+		});
+		printResult(std::string("Large PRIM parse, ") + level_names[static_cast<int>(level)], ms, parsed);
+	}
+	setSimdLevel(supportedSimdLevel());
+}
+
+int main(int argc, char** argv) {
+	//Initilize GlacierFormats library
+	GlacierInit();
+
+	size_t max_count = std::numeric_limits<size_t>::max();
+	if (argc > 1)
+		max_count = std::stoull(argv[1]);
+
+	const auto prims = loadResources("PRIM", max_count);
+
+	size_t parsed = 0;
+	auto ms = measureMilliseconds([&]() {
+		parsed = parsePrims<BinaryReader>(prims, [](const std::vector<char>& data) { return BinaryReader(data.data(), data.size()); });
+	});
+	printResult("PRIM parse, BinaryReader", ms, parsed);
+
+	ms = measureMilliseconds([&]() {
+		parsed = parsePrims<SpanBinaryReader>(prims, [](const std::vector<char>& data) { return SpanBinaryReader(BinaryReaderSpanSource(data.data(), data.size())); });
+	});
+	printResult("PRIM parse, SpanBinaryReader", ms, parsed);
+
+	PRIM::setDefaultDecodeMode(PRIM::DecodeMode::Lazy);
+	ms = measureMilliseconds([&]() {
+		parsed = parsePrims<SpanBinaryReader>(prims, [](const std::vector<char>& data) { return SpanBinaryReader(BinaryReaderSpanSource(data.data(), data.size())); });
+	});
+	printResult("PRIM parse, SpanBinaryReader, lazy", ms, parsed);
+	PRIM::setDefaultDecodeMode(PRIM::DecodeMode::Eager);
+
+	PRIM::setDefaultDecodePool(&ThreadPool::defaultPool());
+	ms = measureMilliseconds([&]() {
+		parsed = parsePrims<SpanBinaryReader>(prims, [](const std::vector<char>& data) { return SpanBinaryReader(BinaryReaderSpanSource(data.data(), data.size())); });
+	});
+	printResult("PRIM parse, SpanBinaryReader, parallel", ms, parsed);
+	PRIM::setDefaultDecodePool(nullptr);
+
+	benchmarkVertexDecode(max_count);
+
+	benchmarkSerialization<PRIM>("PRIM", prims);
+	benchmarkSerialization<TEXD>("TEXD", loadResources("TEXD", max_count));
+}
@@ -1,5 +1,7 @@
 #include "GlacierFormats.h"
 #include <fstream>
+#include <iostream>
+#include <iomanip>
 #include <filesystem>
 #include <map>
 #include <unordered_set>
@@ -14,24 +16,28 @@ int main(int argc, char** argv) {
 	//Get ResourceRepository instance.
 	auto repo = ResourceRepository::instance();
 
-	//Get all runtime ids associated with PRIM resources.
+	//Get all runtime ids associated with PRIM resources and all MATI resources referenced by them.
 	auto prim_ids = repo->getIdsByType("PRIM");
+	auto mati_ids = repo->query(query::type("MATI") && query::referencedBy(query::type("PRIM")));
 
-	std::unordered_map<RuntimeId, std::unique_ptr<MATI>> matis;
-	std::multimap<std::string, RuntimeId> mati_to_prim_multimap;
+	//Parse the MATI resources in parallel and collect their names.
+	using NameMap = std::unordered_map<RuntimeId, std::string>;
+	auto mati_names = repo->forEachResource<MATI>(mati_ids,
+		[](const RuntimeId& id, MATI& mati) { return NameMap{ { id, mati.instanceName() } }; },
+		[](NameMap a, NameMap b) { a.merge(b); return a; },
+		NameMap{});
+
+	for (const auto& failure : mati_names.failures)
+		std::cerr << "Failed to parse MATI " << std::hex << failure.first << ": " << failure.second << "\n";
 
+	std::multimap<std::string, RuntimeId> mati_to_prim_multimap;
 	for (const auto& prim_id : prim_ids) {
-		//Get all the references accociated with the prim id
-		auto references = repo->getResourceReferences(prim_id);
+		//All PRIM resources have a least one MATI references
+		auto references = repo->getResourceReferences(prim_id, "MATI");
 		for (const auto& reference : references) {
-			//Get the type of the referenced resource and check if it's "MATI". 
-			//All PRIM resources have a least one MATI references
-			auto reference_type = repo->getResourceType(reference.id);
-			if (reference_type == "MATI") {
-				//Parse mati resource and add mati_name->prim_id association to multi_map
-				auto mati = repo->getResource<MATI>(reference.id);
-				mati_to_prim_multimap.insert({ mati->name, prim_id });
-			}
+			auto it = mati_names.value.find(reference.id);
+			if (it != mati_names.value.end())
+				mati_to_prim_multimap.insert({ it->second, prim_id });
 		}
 	}
 
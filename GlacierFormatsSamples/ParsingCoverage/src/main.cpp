@@ -37,6 +37,17 @@ BinaryReader getResourceReader(RuntimeId id) {
 	return BinaryReader(std::move(source));
 }
 
+//Submeshes that reference the same serialized buffers share the decoded buffers, so a PRIM uses buffer reuse iff one of
+//its buffers is held by more than one primitive.
+bool hasSharedBuffers(const PRIM& prim) {
+	for (const auto& primitive : prim.primitives) {
+		if (primitive->vertex_buffer.use_count() > 1 || primitive->index_buffer.use_count() > 1 || primitive->vertex_data.use_count() > 1 ||
+			primitive->bone_weight_buffer.use_count() > 1 || primitive->collision_data.use_count() > 1)
+			return true;
+	}
+	return false;
+}
+
 //Gets the ids of all prim resources that don't utilize buffer or mesh reuse.
 std::vector<RuntimeId> getPrimResourcesWithoutSharedBuffers() {
 	std::vector<RuntimeId> out_ids;
@@ -45,7 +56,7 @@ std::vector<RuntimeId> getPrimResourcesWithoutSharedBuffers() {
 	auto prim_ids = repo->getIdsByType("PRIM");
 
 	for (const auto& prim_id : prim_ids) {
-		BinaryReader br = getResourceReader<LoggedBinaryReaderSource<BinaryReaderBufferSource>>(prim_id);
+		BinaryReader br = getResourceReader<CoverageBinaryReaderSource<BinaryReaderBufferSource>>(prim_id);
 		std::unique_ptr<PRIM> prim = nullptr;
 		try {
 			prim = GlacierResource<PRIM>::read(br, prim_id);
@@ -54,15 +65,16 @@ std::vector<RuntimeId> getPrimResourcesWithoutSharedBuffers() {
 			continue;
 		}
 
-		const auto* br_source = dynamic_cast<const LoggedBinaryReaderSource<BinaryReaderBufferSource>*>(br.getSource());
+		const auto* br_source = dynamic_cast<const CoverageBinaryReaderSource<BinaryReaderBufferSource>*>(br.getSource());
+		const auto& read_coverage = br_source->getCoverage();
 
 		//Assert read coverage is 100%
-		GLACIER_ASSERT_TRUE(br_source->converage() == 1.0f);
+		GLACIER_ASSERT_TRUE(read_coverage.isComplete());
 
-		//Select asserts without double read or in other words, assets that don't contains submeshes with shared resource buffers. 
+		//Select assets that don't contain submeshes with shared resource buffers. Shared buffers are only read once, so 
+		//they don't show up as repeated reads in the coverage and are detected on the parsed primitives instead.
 		//We have to filter those since reserializing them perfectly is not possible for a varity of reasons.
-		const auto& access_pattern = br_source->getAccessPattern();
-		if (std::find_if(access_pattern.begin(), access_pattern.end(), [](const auto& c) -> bool {return c != 1; }) == access_pattern.end()) {
+		if (!hasSharedBuffers(*prim)) {
 			
 			//Serialize resource to buffer and compare length to original
 			auto reserialized_prim_buffer = prim->serializeToBuffer();
@@ -120,28 +132,26 @@ void testCoverage(const std::string& type_string) {
 			}
 
 			//Parse and reserialize to file
-			auto source = std::make_unique<LoggedBinaryReaderSource<BinaryReaderBufferSource>>(data_o.get(), data_size_o);
+			auto source = std::make_unique<CoverageBinaryReaderSource<BinaryReaderBufferSource>>(data_o.get(), data_size_o);
 			BinaryReader br(std::move(source));
 			std::unique_ptr<Type> resource = GlacierResource<Type>::read(br, id);
 
 			//check overage
-			//const auto* src = dynamic_cast<const LoggedBinaryReaderSource<BinaryReaderBufferSource>*>(br.getSource());
-			//auto read_coverage = src->converage();
-			//const auto& access_pattern = src->getAccessPattern();
+			//const auto* src = dynamic_cast<const CoverageBinaryReaderSource<BinaryReaderBufferSource>*>(br.getSource());
+			//const auto& read_coverage = src->getCoverage();
 
-			//if (std::find_if(access_pattern.begin(), access_pattern.end(), [](const auto& c) -> bool {return c != 1; }) != access_pattern.end()) {
+			//if (read_coverage.hasRepeatedReads()) {
 			//	//PRIM has double read.
 			//	++double_read_cnt;
 			//}
 
 			////If coverage isn't 100% print file and first loc of first unparsed byte
-			//if (read_coverage != 1.0) {
-			//	auto first = std::find(access_pattern.begin(), access_pattern.end(), 0);
-			//	auto offset = first - access_pattern.begin();
+			//if (!read_coverage.isComplete()) {
+			//	auto offset = read_coverage.gaps().front().begin;
 
 			//	GLACIER_DEBUG_PRINT("id: %s\ncoverage: %f\nunparsed byte off: %I64X\n", 
 			//		static_cast<std::string>(id).c_str(), 
-			//		read_coverage, 
+			//		read_coverage.coverage(), 
 			//		offset);
 			//}
 
@@ -0,0 +1,322 @@
+#include <gtest/gtest.h>
+#include "GlacierFormats.h"
+#include <random>
+#include <cstring>
+#include <algorithm>
+
+using namespace GlacierFormats;
+
+namespace {
+
+    //PRIM resource the tests below run against.
+    const RuntimeId test_prim_id = 0x002F5293D4F41A8D;
+
+    //Returns the serialized test PRIM.
+    std::vector<char> testPrimData() {
+        return ResourceRepository::instance()->getResource(test_prim_id);
+    }
+
+    //Returns the test PRIM parsed by the repository.
+    std::unique_ptr<PRIM> testPrim() {
+        return ResourceRepository::instance()->getResource<PRIM>(test_prim_id);
+    }
+
+    //Returns true if parsing data with reader type R throws.
+    template<typename R>
+    bool primParseThrows(const std::vector<char>& data) {
+        try {
+            if constexpr (std::is_same_v<R, BinaryReader>) {
+                BinaryReader br(data.data(), data.size());
+                GlacierResource<PRIM>::read(br, static_cast<uint64_t>(0));
+            }
+            else {
+                GlacierResource<PRIM>::readFromBuffer(data.data(), data.size(), static_cast<uint64_t>(0));
+            }
+        }
+        catch (const std::exception&) {
+            return true;
+        }
+        return false;
+    }
+
+    //Returns the serialized positions, bone weights and vertex data records of every submesh of a PRIM in object table order.
+    std::vector<std::vector<char>> serializedVertexStreams(const std::vector<char>& data) {
+        SpanBinaryReader br(BinaryReaderSpanSource(data.data(), data.size()));
+        br.seek(br.read<uint32_t>());
+        const auto header = br.read<SPrimObjectHeader>();
+        const bool is_high_res = ((int)header.property_flags & (int)SPrimObjectHeader::PROPERTY_FLAGS::HAS_HIRES_POSITIONS) != 0;
+
+        std::vector<std::vector<char>> streams;
+        for (int i = 0; i < header.num_objects; ++i) {
+            br.seek(header.object_table + i * sizeof(uint32_t));
+            br.seek(br.read<uint32_t>());
+            const auto mesh = br.read<SPrimMesh>();
+            br.seek(mesh.sub_mesh_table);
+            br.seek(br.read<uint32_t>());
+            const auto submesh = br.read<SPrimSubMesh>();
+
+            size_t vertex_size = (is_high_res ? 3 * sizeof(float) : 4 * sizeof(int16_t)) + VertexCodec::vertex_data_record_size;
+            if (mesh.sub_type == SPrimObject::SUBTYPE::SUBTYPE_WEIGHTED)
+                vertex_size += VertexWeights::serialized_size;
+            const auto begin = data.begin() + submesh.vertex_buffer;
+            streams.emplace_back(begin, begin + vertex_size * submesh.num_vertex);
+        }
+        return streams;
+    }
+
+}
+
+//The span reader validates submesh streams up front and decodes them unchecked. Both reader policies have to reject the 
+//same malformed inputs.
+GTEST_TEST(PRIM, MalformedInputPolicyEquivalence) {
+    const auto original = testPrimData();
+    ASSERT_FALSE(original.size() < 4);
+
+    std::mt19937 rng(0x5052494D);
+    std::uniform_int_distribution<size_t> word_dist(0, original.size() / 4 - 1);
+    std::uniform_int_distribution<uint32_t> value_dist;
+
+    for (int i = 0; i < 0x200; ++i) {
+        auto mutated = original;
+        const uint32_t value = (i % 2) ? value_dist(rng) : (value_dist(rng) & 0xFFFF);
+        std::memcpy(&mutated[4 * word_dist(rng)], &value, sizeof(value));
+
+        ASSERT_EQ(primParseThrows<BinaryReader>(mutated), primParseThrows<SpanBinaryReader>(mutated));
+    }
+
+    //Truncated inputs
+    for (size_t size = 0; size < original.size(); size += 0x40) {
+        std::vector<char> truncated(original.begin(), original.begin() + size);
+        ASSERT_TRUE(primParseThrows<BinaryReader>(truncated));
+        ASSERT_TRUE(primParseThrows<SpanBinaryReader>(truncated));
+    }
+}
+
+//Lazily parsed PRIMs decode their vertex streams on first access and have to match eagerly parsed ones.
+GTEST_TEST(PRIM, LazyDecoding) {
+    const auto data = testPrimData();
+
+    SpanBinaryReader eager_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM eager(eager_br, test_prim_id, PRIM::DecodeMode::Eager);
+    SpanBinaryReader lazy_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM lazy(lazy_br, test_prim_id, PRIM::DecodeMode::Lazy);
+
+    ASSERT_EQ(eager.primitives.size(), lazy.primitives.size());
+    for (size_t i = 0; i < eager.primitives.size(); ++i) {
+        const auto& e = *eager.primitives[i];
+        const auto& l = *lazy.primitives[i];
+        ASSERT_EQ(e.vertexCount(), l.vertexCount());
+        ASSERT_EQ(e.materialId(), l.materialId());
+        ASSERT_EQ(e.getIndexBuffer(), l.getIndexBuffer());
+        ASSERT_EQ(e.getVertexBuffer(), l.getVertexBuffer());
+        ASSERT_EQ(e.getNormals(), l.getNormals());
+        ASSERT_EQ(e.getTangents(), l.getTangents());
+        ASSERT_EQ(e.getUVs(), l.getUVs());
+        ASSERT_EQ(e.getBoneWeights().size(), l.getBoneWeights().size());
+    }
+
+    SpanBinaryReader unread_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM unread(unread_br, test_prim_id, PRIM::DecodeMode::Lazy);
+    ASSERT_EQ(eager.serializeToBuffer(), unread.serializeToBuffer());
+}
+
+//Unmodified buffers are written back verbatim with their original compression parameters, so reserializing a PRIM
+//doesn't change its decoded vertex data.
+GTEST_TEST(PRIM, UnmodifiedBufferPassthrough) {
+    const auto original = testPrim();
+    const auto data = original->serializeToBuffer();
+    ASSERT_EQ(serializedVertexStreams(data), serializedVertexStreams(testPrimData()));
+    const auto reserialized = GlacierResource<PRIM>::readFromBuffer(data, test_prim_id);
+
+    ASSERT_EQ(original->primitives.size(), reserialized->primitives.size());
+    for (size_t i = 0; i < original->primitives.size(); ++i) {
+        const auto& o = *original->primitives[i];
+        const auto& r = *reserialized->primitives[i];
+        ASSERT_EQ(o.getVertexBuffer(), r.getVertexBuffer());
+        ASSERT_EQ(o.getNormals(), r.getNormals());
+        ASSERT_EQ(o.getTangents(), r.getTangents());
+        ASSERT_EQ(o.getUVs(), r.getUVs());
+    }
+
+    //Modified buffers are requantized.
+    auto& primitive = *original->primitives[0];
+    std::vector<float> uvs(2 * primitive.vertexCount());
+    for (size_t i = 0; i < uvs.size(); ++i)
+        uvs[i] = static_cast<float>(i % 7) / 7.0f;
+    primitive.setUVs(uvs);
+    const auto modified = GlacierResource<PRIM>::readFromBuffer(original->serializeToBuffer(), test_prim_id);
+    const auto modified_uvs = modified->primitives[0]->getUVs();
+    ASSERT_EQ(modified_uvs.size(), uvs.size());
+    //getUVs flips the v coordinate.
+    for (size_t i = 0; i < uvs.size(); ++i)
+        ASSERT_NEAR(modified_uvs[i], (i % 2) ? -uvs[i] : uvs[i], 1e-3f);
+}
+
+//Submeshes that reference the same serialized buffers share the decoded buffers, which are written back once.
+GTEST_TEST(PRIM, SharedBuffers) {
+    auto prim = testPrim();
+    const auto unshared_size = prim->serializeToBuffer().size();
+
+    const auto& source = *prim->primitives[0];
+    auto lod = std::make_unique<ZRenderPrimitive>();
+    lod->remnant = source.remnant;
+    lod->remnant.lod_mask = 0x80;
+    lod->vertex_buffer = source.vertex_buffer;
+    lod->index_buffer = source.index_buffer;
+    lod->vertex_data = source.vertex_data;
+    lod->bone_weight_buffer = source.bone_weight_buffer;
+    lod->vertex_colors = source.vertex_colors;
+    prim->primitives.push_back(std::move(lod));
+
+    const auto data = prim->serializeToBuffer();
+    ASSERT_LT(data.size(), unshared_size + 0x200);
+
+    const auto shared = GlacierResource<PRIM>::readFromBuffer(data, test_prim_id);
+    const auto& first = *shared->primitives.front();
+    const auto& last = *shared->primitives.back();
+    ASSERT_EQ(first.vertex_buffer, last.vertex_buffer);
+    ASSERT_EQ(first.index_buffer, last.index_buffer);
+    ASSERT_EQ(first.vertex_data, last.vertex_data);
+    ASSERT_EQ(shared->serializeToBuffer().size(), data.size());
+
+    //Shared buffers are copied before they are modified.
+    const auto uvs = first.getUVs();
+    shared->primitives.back()->setUVs(std::vector<float>(uvs.size(), 0.5f));
+    ASSERT_NE(first.vertex_data, last.vertex_data);
+    ASSERT_EQ(first.getUVs(), uvs);
+}
+
+GTEST_TEST(PRIM, ParallelDecoding) {
+    const auto data = testPrimData();
+
+    SpanBinaryReader sequential_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM sequential(sequential_br, test_prim_id, PRIM::DecodeMode::Eager);
+
+    ThreadPool pool(4);
+    for (auto mode : { PRIM::DecodeMode::Eager, PRIM::DecodeMode::Lazy }) {
+        BinaryReader parallel_br(data.data(), data.size());
+        PRIM parallel(parallel_br, test_prim_id, mode, pool);
+
+        ASSERT_EQ(sequential.primitives.size(), parallel.primitives.size());
+        for (size_t i = 0; i < sequential.primitives.size(); ++i) {
+            const auto& s = *sequential.primitives[i];
+            const auto& p = *parallel.primitives[i];
+            ASSERT_EQ(s.materialId(), p.materialId());
+            ASSERT_EQ(s.getIndexBuffer(), p.getIndexBuffer());
+            ASSERT_EQ(s.getVertexBuffer(), p.getVertexBuffer());
+            ASSERT_EQ(s.getUVs(), p.getUVs());
+        }
+        ASSERT_EQ(sequential.serializeToBuffer(), parallel.serializeToBuffer());
+    }
+}
+
+GTEST_TEST(PRIM, MeshViews) {
+    auto prim = testPrim();
+
+    for (const auto& primitive : prim->primitives) {
+        const IMesh* mesh = primitive.get();
+        std::vector<float> scratch, packed;
+
+        //Decoded positions are viewed in place, including their padding.
+        const auto positions = mesh->vertexBufferView(scratch);
+        ASSERT_FALSE(positions.isContiguous());
+        ASSERT_TRUE(scratch.empty());
+        const auto packed_positions = positions.contiguous(packed);
+        ASSERT_EQ(std::vector<float>(packed_positions.begin(), packed_positions.end()), mesh->getVertexBuffer());
+
+        const auto normals = mesh->normalsView(scratch).contiguous(packed);
+        ASSERT_EQ(std::vector<float>(normals.begin(), normals.end()), mesh->getNormals());
+        const auto uvs = mesh->uvsView(scratch).contiguous(packed);
+        ASSERT_EQ(std::vector<float>(uvs.begin(), uvs.end()), mesh->getUVs());
+
+        std::vector<unsigned short> index_scratch;
+        const auto indices = mesh->indexBufferView(index_scratch);
+        ASSERT_EQ(std::vector<unsigned short>(indices.begin(), indices.end()), mesh->getIndexBuffer());
+    }
+
+    //Move setters take over buffers that are stored in canonical layout.
+    auto indices = prim->primitives[0]->getIndexBuffer();
+    std::reverse(indices.begin(), indices.end());
+    const auto expected = indices;
+    const auto* data = indices.data();
+    prim->primitives[0]->setIndexBuffer(std::move(indices));
+    std::vector<unsigned short> index_scratch;
+    ASSERT_EQ(prim->primitives[0]->indexBufferView(index_scratch).data(), data);
+    ASSERT_EQ(prim->primitives[0]->getIndexBuffer(), expected);
+}
+
+//Compactly parsed PRIMs keep their vertex streams packed and decode them on every access.
+GTEST_TEST(PRIM, CompactDecoding) {
+    const auto data = testPrimData();
+
+    SpanBinaryReader eager_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM eager(eager_br, test_prim_id, PRIM::DecodeMode::Eager);
+    SpanBinaryReader compact_br(BinaryReaderSpanSource(data.data(), data.size()));
+    PRIM compact(compact_br, test_prim_id, PRIM::DecodeMode::Compact);
+
+    ASSERT_EQ(eager.primitives.size(), compact.primitives.size());
+    for (size_t i = 0; i < eager.primitives.size(); ++i) {
+        const auto& e = *eager.primitives[i];
+        const auto& c = *compact.primitives[i];
+        ASSERT_EQ(e.name(), c.name());
+        ASSERT_EQ(e.getVertexBuffer(), c.getVertexBuffer());
+        ASSERT_EQ(e.getNormals(), c.getNormals());
+        ASSERT_EQ(e.getTangents(), c.getTangents());
+        ASSERT_EQ(e.getUVs(), c.getUVs());
+        ASSERT_EQ(e.getBoneWeights().size(), c.getBoneWeights().size());
+
+        std::vector<float> scratch, packed;
+        const auto positions = c.vertexBufferView(scratch).contiguous(packed);
+        ASSERT_EQ(std::vector<float>(positions.begin(), positions.end()), e.getVertexBuffer());
+    }
+    ASSERT_EQ(eager.serializeToBuffer(), compact.serializeToBuffer());
+}
+
+//Primitives with equal submeshes are serialized with a single submesh even if they don't share their buffers.
+GTEST_TEST(PRIM, SubmeshDeduplication) {
+    auto prim = testPrim();
+    const auto size = prim->serializeToBuffer().size();
+
+    //A second parse of the same resource has equal but distinct buffers.
+    auto copy = testPrim();
+    auto lod = std::move(copy->primitives[0]);
+    lod->remnant.lod_mask = 0x80;
+    ASSERT_NE(lod->vertex_buffer, prim->primitives[0]->vertex_buffer);
+    ASSERT_TRUE(lod->submeshEquals(*prim->primitives[0]));
+    prim->primitives.push_back(std::move(lod));
+
+    const auto data = prim->serializeToBuffer();
+    ASSERT_LT(data.size(), size + 0x200);
+
+    const auto deduplicated = GlacierResource<PRIM>::readFromBuffer(data, test_prim_id);
+    const auto& first = *deduplicated->primitives.front();
+    const auto& last = *deduplicated->primitives.back();
+    ASSERT_EQ(first.vertex_buffer, last.vertex_buffer);
+    ASSERT_EQ(first.index_buffer, last.index_buffer);
+    ASSERT_EQ(last.remnant.lod_mask, 0x80);
+
+    //Modified submeshes are serialized separately.
+    prim->primitives.back()->setUVs(std::vector<float>(2 * prim->primitives.back()->vertexCount(), 0.5f));
+    ASSERT_FALSE(prim->primitives.back()->submeshEquals(*prim->primitives[0]));
+    ASSERT_GT(prim->serializeToBuffer().size(), data.size());
+}
+
+//Separately built buffers that are equal to an already written buffer are written once.
+GTEST_TEST(PRIM, EqualBuffersWrittenOnce) {
+    auto prim = testPrim();
+    const auto size = prim->serializeToBuffer().size();
+
+    auto copy = testPrim();
+    auto variant = std::move(copy->primitives[0]);
+    auto indices = variant->getIndexBuffer();
+    std::reverse(indices.begin(), indices.end());
+    variant->setIndexBuffer(indices);
+    prim->primitives.push_back(std::move(variant));
+
+    const auto data = prim->serializeToBuffer();
+    ASSERT_LT(data.size(), size + indices.size() * sizeof(uint16_t) + 0x200);
+
+    const auto reparsed = GlacierResource<PRIM>::readFromBuffer(data, test_prim_id);
+    ASSERT_EQ(reparsed->primitives.front()->vertex_buffer, reparsed->primitives.back()->vertex_buffer);
+    ASSERT_EQ(reparsed->primitives.back()->getIndexBuffer(), indices);
+}
@@ -0,0 +1,369 @@
+#include <gtest/gtest.h>
+#include "GlacierFormats.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace GlacierFormats;
+
+GTEST_TEST(ResourceRepository, QueryByType) {
+    const auto& repo = ResourceRepository::instance();
+
+    auto expected = repo->getIdsByType("MATI");
+    auto queried = repo->query(query::type("MATI"));
+
+    auto less = [](const RuntimeId& a, const RuntimeId& b) { return static_cast<uint64_t>(a) < static_cast<uint64_t>(b); };
+    std::sort(expected.begin(), expected.end(), less);
+    ASSERT_EQ(expected.size(), queried.size());
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), queried.begin(), [](const RuntimeId& a, const RuntimeId& b) { return static_cast<uint64_t>(a) == static_cast<uint64_t>(b); }));
+}
+
+GTEST_TEST(ResourceRepository, QueryReferences) {
+    const auto& repo = ResourceRepository::instance();
+    const auto index = repo->getMetadataIndex();
+
+    const auto texds = repo->query(query::type("TEXD") && query::referencedBy(query::type("TEXT")));
+    for (const auto& id : texds) {
+        ASSERT_EQ(repo->getResourceType(id), "TEXD");
+        ASSERT_FALSE(repo->getResourceBackReferences(id, "TEXT").empty());
+    }
+
+    const auto large = repo->query(query::dataSize() > 0x400000);
+    for (const auto& id : large)
+        ASSERT_GT(index->data_sizes[index->rows.at(id)], 0x400000u);
+}
+
+GTEST_TEST(ResourceRepository, RefreshWithoutChanges) {
+    const auto& repo = ResourceRepository::instance();
+    const auto before = repo->snapshot();
+
+    const auto report = repo->refresh();
+    ASSERT_TRUE(report.empty());
+    ASSERT_EQ(before, repo->snapshot());
+}
+
+//Refresh of a patched copy of the runtime directory. Only the two smallest archives are copied, the patch is written
+//before it's read from since open archives can't be replaced on Windows.
+GTEST_TEST(ResourceRepository, RefreshPatchedDirectory) {
+    const auto directory = std::filesystem::temp_directory_path() / "GlacierFormatsTests_RefreshPatchedDirectory";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::filesystem::path> runtime_archives;
+    for (const auto& it : std::filesystem::directory_iterator(ResourceRepository::runtime_dir)) {
+        if (it.path().extension() == ".rpkg")
+            runtime_archives.push_back(it.path());
+    }
+    ASSERT_GE(runtime_archives.size(), 2u);
+    std::sort(runtime_archives.begin(), runtime_archives.end(), [](const auto& a, const auto& b) { return std::filesystem::file_size(a) < std::filesystem::file_size(b); });
+    runtime_archives.resize(2);
+    std::sort(runtime_archives.begin(), runtime_archives.end());
+    for (const auto& path : runtime_archives)
+        std::filesystem::copy_file(path, directory / path.filename());
+
+    //Sorts after the copied archives, its entries shadow theirs.
+    const auto patch_path = directory / "zzzz_refreshtest.rpkg";
+    const std::vector<ResourceReference> references;
+    auto writePatch = [&](const std::vector<std::pair<RuntimeId, std::vector<char>>>& files) {
+        RPKG rpkg;
+        rpkg.deletion_list.push_back(0x0012345600000010);
+        for (const auto& file : files)
+            rpkg.insertFile(file.first, "TEST", file.second, &references);
+        rpkg.write(patch_path);
+    };
+
+    {
+        ResourceRepository repo(directory, std::make_shared<RepositoryContext>(64 * 1024 * 1024));
+        const auto initial = repo.snapshot();
+        ASSERT_EQ(initial->archives.size(), 2u);
+        ASSERT_FALSE(initial->archives[0]->info_data.empty());
+        const RuntimeId patched_id = initial->archives[0]->info_data.front().runtimeID;
+        const RuntimeId new_id = 0x0012345600000001;
+        ASSERT_FALSE(repo.contains(new_id));
+        ASSERT_TRUE(repo.refresh().empty());
+
+        //Added archive. Unchanged archives are reused.
+        writePatch({ { patched_id, std::vector<char>(0x100, 'a') }, { new_id, std::vector<char>(0x10, 'b') } });
+        const auto added = repo.refresh();
+        ASSERT_EQ(added.added, std::vector<std::string>{ "zzzz_refreshtest" });
+        ASSERT_TRUE(added.removed.empty());
+        ASSERT_TRUE(added.changed.empty());
+        const auto patched = repo.snapshot();
+        ASSERT_EQ(patched->archives.size(), 3u);
+        ASSERT_EQ(patched->archives[0].get(), initial->archives[0].get());
+        ASSERT_EQ(patched->archives[1].get(), initial->archives[1].get());
+        ASSERT_EQ(repo.getResourceType(patched_id), "TEST");
+        ASSERT_TRUE(repo.contains(new_id));
+
+        //Rewritten archive. Reads from the old index fail instead of returning data from the wrong offsets.
+        writePatch({ { patched_id, std::vector<char>(0x200, 'c') }, { new_id, std::vector<char>(0x10, 'd') } });
+        const auto changed = repo.refresh();
+        ASSERT_TRUE(changed.added.empty());
+        ASSERT_TRUE(changed.removed.empty());
+        ASSERT_EQ(changed.changed, std::vector<std::string>{ "zzzz_refreshtest" });
+        const auto rewritten = repo.snapshot();
+        ASSERT_EQ(rewritten->archives.size(), 3u);
+        ASSERT_EQ(rewritten->archives[0].get(), initial->archives[0].get());
+        ASSERT_EQ(rewritten->archives[1].get(), initial->archives[1].get());
+        ASSERT_NE(rewritten->archives[2].get(), patched->archives[2].get());
+        ASSERT_EQ(repo.getResource(patched_id), std::vector<char>(0x200, 'c'));
+        ASSERT_EQ(repo.getResource(new_id), std::vector<char>(0x10, 'd'));
+        char buffer[4];
+        ASSERT_THROW(patched->archives[2]->read(patched->find(new_id)->info->data_offset, buffer, sizeof(buffer)), InvalidArgumentsException);
+
+        //Removed archive.
+        std::filesystem::remove(directory / runtime_archives[1].filename());
+        const auto removed = repo.refresh();
+        ASSERT_TRUE(removed.added.empty());
+        ASSERT_EQ(removed.removed, std::vector<std::string>{ runtime_archives[1].stem().generic_string() });
+        ASSERT_TRUE(removed.changed.empty());
+        const auto current = repo.snapshot();
+        ASSERT_EQ(current->archives.size(), 2u);
+        ASSERT_EQ(current->archives[0].get(), initial->archives[0].get());
+        ASSERT_EQ(current->archives[1].get(), rewritten->archives[2].get());
+        ASSERT_EQ(repo.getResource(patched_id), std::vector<char>(0x200, 'c'));
+
+        //A half-copied archive is skipped without being reported and picked up once it's complete.
+        const auto partial_path = directory / "zzzz_refreshtest_partial.rpkg";
+        std::filesystem::copy_file(patch_path, partial_path);
+        std::filesystem::resize_file(partial_path, std::filesystem::file_size(patch_path) - 1);
+        ASSERT_TRUE(repo.refresh().empty());
+        ASSERT_EQ(repo.snapshot(), current);
+        std::filesystem::copy_file(patch_path, partial_path, std::filesystem::copy_options::overwrite_existing);
+        ASSERT_EQ(repo.refresh().added, std::vector<std::string>{ "zzzz_refreshtest_partial" });
+        ASSERT_EQ(repo.snapshot()->archives.size(), 3u);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+GTEST_TEST(ResourceRepository, DiffOfIdenticalRepositoriesIsEmpty) {
+    auto context = std::make_shared<RepositoryContext>(64 * 1024 * 1024);
+    ResourceRepository a(ResourceRepository::runtime_dir, context);
+    ResourceRepository b(ResourceRepository::runtime_dir, context);
+
+    const auto diff = diffRepositories(a, b);
+    ASSERT_TRUE(diff.added.empty());
+    ASSERT_TRUE(diff.removed.empty());
+    ASSERT_TRUE(diff.changed.empty());
+
+    const auto mati_ids = a.getIdsByType("MATI");
+    ASSERT_FALSE(mati_ids.empty());
+    ASSERT_EQ(a.getResource(mati_ids.front()), b.getResource(mati_ids.front()));
+}
+
+//Both repositories share a copy of the smallest runtime archive, the patch of the second one adds, removes and rewrites
+//resources. Rewrites are detected by metadata and, for resources of equal size, by data.
+GTEST_TEST(ResourceRepository, DiffOfPatchedRepositories) {
+    const auto from_directory = std::filesystem::temp_directory_path() / "GlacierFormatsTests_DiffFrom";
+    const auto to_directory = std::filesystem::temp_directory_path() / "GlacierFormatsTests_DiffTo";
+
+    std::filesystem::path base_archive;
+    for (const auto& it : std::filesystem::directory_iterator(ResourceRepository::runtime_dir)) {
+        if ((it.path().extension() == ".rpkg") && (base_archive.empty() || (it.file_size() < std::filesystem::file_size(base_archive))))
+            base_archive = it.path();
+    }
+    ASSERT_FALSE(base_archive.empty());
+    for (const auto& directory : { from_directory, to_directory }) {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        std::filesystem::copy_file(base_archive, directory / base_archive.filename());
+    }
+
+    const std::vector<ResourceReference> references;
+    auto writePatch = [&](const std::filesystem::path& directory, const std::vector<std::pair<RuntimeId, std::vector<char>>>& files) {
+        RPKG rpkg;
+        rpkg.deletion_list.push_back(0x0012345600000010);
+        for (const auto& file : files)
+            rpkg.insertFile(file.first, "TEST", file.second, &references);
+        rpkg.write(directory / "zzzz_difftest.rpkg");
+    };
+    auto ids = [](const std::vector<RuntimeId>& runtime_ids) {
+        std::vector<uint64_t> values;
+        for (const auto& id : runtime_ids)
+            values.push_back(static_cast<uint64_t>(id));
+        return values;
+    };
+
+    const RuntimeId removed_id = 0x0012345600000001;
+    const RuntimeId added_id = 0x0012345600000002;
+    const RuntimeId rewritten_id = 0x0012345600000003;
+    //Stored at different offsets in both patches, equal metadata and data.
+    const RuntimeId unchanged_id = 0x0012345600000004;
+    writePatch(from_directory, { { removed_id, std::vector<char>(0x10, 'r') }, { rewritten_id, std::vector<char>(0x100, 'a') }, { unchanged_id, std::vector<char>(0x20, 'u') } });
+
+    {
+        ResourceRepository from(from_directory, std::make_shared<RepositoryContext>());
+        const auto base_id = from.snapshot()->archives.front()->info_data.front().runtimeID;
+        writePatch(to_directory, { { added_id, std::vector<char>(0x30, 'n') }, { rewritten_id, std::vector<char>(0x100, 'b') }, { unchanged_id, std::vector<char>(0x20, 'u') }, { base_id, std::vector<char>(0x40, 'p') } });
+        ResourceRepository to(to_directory, from.getContext());
+
+        const auto diff = diffRepositories(from, to);
+        ASSERT_EQ(ids(diff.added), std::vector<uint64_t>{ static_cast<uint64_t>(added_id) });
+        ASSERT_EQ(ids(diff.removed), std::vector<uint64_t>{ static_cast<uint64_t>(removed_id) });
+        auto expected_changed = std::vector<uint64_t>{ static_cast<uint64_t>(rewritten_id), base_id };
+        std::sort(expected_changed.begin(), expected_changed.end());
+        ASSERT_EQ(ids(diff.changed), expected_changed);
+    }
+    std::filesystem::remove_all(from_directory);
+    std::filesystem::remove_all(to_directory);
+}
+
+//Failures are reported per resource without aborting the sweep, the values of all other resources are reduced.
+GTEST_TEST(ResourceRepository, ForEachResourceReduce) {
+    const auto& repo = ResourceRepository::instance();
+    auto ids = repo->getIdsByType("MATI");
+    ids.resize(std::min<size_t>(ids.size(), 64));
+    ASSERT_GT(ids.size(), 1u);
+
+    const RuntimeId missing_id = 0x00FFFFFFFFFFFFFF;
+    ASSERT_FALSE(repo->contains(missing_id));
+    const uint64_t throwing_id = static_cast<uint64_t>(ids.front());
+    ids.push_back(missing_id);
+
+    uint64_t expected_sum = 0;
+    for (size_t i = 1; i + 1 < ids.size(); ++i)
+        expected_sum += static_cast<uint64_t>(ids[i]);
+
+    ThreadPool pool(4);
+    const auto result = repo->forEachResource<MATI>(ids, [&](const RuntimeId& id, MATI&) {
+            if (static_cast<uint64_t>(id) == throwing_id)
+                throw std::runtime_error("forEachResource test");
+            return static_cast<uint64_t>(id);
+        },
+        [](uint64_t a, uint64_t b) { return a + b; }, static_cast<uint64_t>(0), &pool);
+
+    ASSERT_EQ(result.value, expected_sum);
+    ASSERT_EQ(result.processed, ids.size() - 2);
+    ASSERT_TRUE(result.unsupported.empty());
+    ASSERT_EQ(result.failures.size(), 2u);
+    std::vector<uint64_t> failed_ids;
+    for (const auto& failure : result.failures)
+        failed_ids.push_back(static_cast<uint64_t>(failure.first));
+    ASSERT_NE(std::find(failed_ids.begin(), failed_ids.end(), throwing_id), failed_ids.end());
+    ASSERT_NE(std::find(failed_ids.begin(), failed_ids.end(), static_cast<uint64_t>(missing_id)), failed_ids.end());
+
+    //The overload without reduction runs on the pool of the repository context.
+    std::atomic<size_t> calls = 0;
+    const auto report = repo->forEachResource<MATI>(ids, [&](const RuntimeId&, MATI&) { ++calls; });
+    ASSERT_EQ(report.processed, ids.size() - 1);
+    ASSERT_EQ(calls.load(), ids.size() - 1);
+    ASSERT_EQ(report.failures.size(), 1u);
+}
+
+//Cached payloads survive reopening. Damaged cache files only lose the affected entries: records past the end of the pack
+//are dropped, a partial trailing index record is truncated, corrupted payloads fail their checksum and an invalid header
+//resets the cache.
+GTEST_TEST(PersistentResourceCache, Recovery) {
+    const auto directory = std::filesystem::temp_directory_path() / "GlacierFormatsTests_PersistentResourceCache";
+    const auto pack_path = directory / "payloads.pack";
+    const auto index_path = directory / "payloads.idx";
+    std::filesystem::remove_all(directory);
+
+    auto key = [](uint64_t i) { return PersistentResourceCache::Key{ 0x1000 + i, 1, 0x10 * i }; };
+    auto payload = [](uint64_t i) { return std::vector<char>(0x100 + i, static_cast<char>(i + 1)); };
+    auto insert = [&](PersistentResourceCache& cache, uint64_t i) {
+        const auto data = payload(i);
+        cache.insert(key(i), data.data(), data.size());
+    };
+    auto readsBack = [&](PersistentResourceCache& cache, uint64_t i) {
+        const auto expected = payload(i);
+        std::vector<char> data(expected.size());
+        return cache.read(key(i), data.data(), data.size()) && data == expected;
+    };
+
+    {
+        PersistentResourceCache cache(directory);
+        for (uint64_t i = 0; i < 4; ++i)
+            insert(cache, i);
+        insert(cache, 0);
+        ASSERT_EQ(cache.count(), 4u);
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 4u);
+        for (uint64_t i = 0; i < 4; ++i)
+            ASSERT_TRUE(readsBack(cache, i));
+        std::vector<char> data(0x10);
+        ASSERT_FALSE(cache.read(key(0), data.data(), data.size()));
+    }
+
+    //Truncated pack. Payloads appended later don't revive the record of the incomplete payload.
+    std::filesystem::resize_file(pack_path, std::filesystem::file_size(pack_path) - 1);
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 3u);
+        ASSERT_FALSE(cache.contains(key(3)));
+        insert(cache, 4);
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 4u);
+        ASSERT_FALSE(cache.contains(key(3)));
+        for (uint64_t i : { 0, 1, 2, 4 })
+            ASSERT_TRUE(readsBack(cache, i));
+    }
+
+    //Partial trailing index record.
+    const auto index_size = std::filesystem::file_size(index_path);
+    std::ofstream(index_path, std::ofstream::binary | std::ofstream::app).write("\x01\x02\x03", 3);
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 4u);
+        ASSERT_EQ(std::filesystem::file_size(index_path), index_size);
+        insert(cache, 5);
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 5u);
+        ASSERT_TRUE(readsBack(cache, 5));
+    }
+
+    //Invalid header.
+    std::fstream(index_path, std::fstream::in | std::fstream::out | std::fstream::binary).write("XXXX", 4);
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 0u);
+        ASSERT_EQ(std::filesystem::file_size(pack_path), 0u);
+        insert(cache, 0);
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 1u);
+        ASSERT_TRUE(readsBack(cache, 0));
+    }
+
+    //Corrupted payload. The record is dropped and the payload can be cached again.
+    {
+        std::fstream pack(pack_path, std::fstream::in | std::fstream::out | std::fstream::binary);
+        pack.seekp(0x10);
+        pack.put(0x7F);
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_FALSE(readsBack(cache, 0));
+        ASSERT_FALSE(cache.contains(key(0)));
+        insert(cache, 0);
+        ASSERT_TRUE(readsBack(cache, 0));
+    }
+
+    //Concurrent inserts of the same key append the payload once.
+    {
+        PersistentResourceCache cache(directory);
+        const auto pack_size = std::filesystem::file_size(pack_path);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < 8; ++i)
+            threads.emplace_back([&]() { insert(cache, 6); });
+        for (auto& thread : threads)
+            thread.join();
+        ASSERT_EQ(std::filesystem::file_size(pack_path), pack_size + payload(6).size());
+        ASSERT_TRUE(readsBack(cache, 6));
+    }
+    {
+        PersistentResourceCache cache(directory);
+        ASSERT_EQ(cache.count(), 2u);
+        ASSERT_TRUE(readsBack(cache, 0));
+        ASSERT_TRUE(readsBack(cache, 6));
+    }
+    std::filesystem::remove_all(directory);
+}
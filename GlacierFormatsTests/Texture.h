@@ -25,4 +25,43 @@ GTEST_TEST(Texture, GenerateTextureFromRepo) {
     Texture texture(0x00f21881494e8789);
     ASSERT_TRUE(texture.texd);
     ASSERT_TRUE(texture.text);
-}
\ No newline at end of file
+}
+
+//Pixels are serialized as a reference to the texture, archives write the segments without gathering them.
+GTEST_TEST(Texture, SerializeToSegments) {
+    RuntimeId texd_id = 0x00f21881494e8789;
+    auto texd = ResourceRepository::instance()->getResource<TEXD>(texd_id);
+    ASSERT_TRUE(texd);
+
+    const auto buf = texd->serializeToBuffer();
+    const auto segments = texd->serializeToSegments();
+    ASSERT_EQ(segments.size(), 2u);
+    ASSERT_FALSE(segments.back().owner);
+    std::vector<char> concatenated;
+    for (const auto& segment : segments)
+        concatenated.insert(concatenated.end(), segment.data, segment.data + segment.size);
+    ASSERT_EQ(concatenated, buf);
+
+    //The second file keeps RPKG from guessing a base archive from the entry following the texture.
+    const auto path = std::filesystem::temp_directory_path() / "GlacierFormatsTests_SerializeToSegments.rpkg";
+    const std::vector<ResourceReference> references;
+    const RuntimeId copy_id = 0x0012345600000001;
+    {
+        RPKG rpkg;
+        rpkg.deletion_list.push_back(0x0012345600000010);
+        rpkg.insertFile(texd_id, "TEXD", segments, &references);
+        rpkg.insertFile(copy_id, "TEXD", buf, &references);
+        rpkg.write(path);
+    }
+
+    {
+        RPKG rpkg(path);
+        for (const auto& id : { texd_id, copy_id }) {
+            char* file_data = nullptr;
+            const auto size = rpkg.getFileData(id, &file_data);
+            std::unique_ptr<char[]> owner(file_data);
+            ASSERT_EQ(std::vector<char>(file_data, file_data + size), buf);
+        }
+    }
+    std::filesystem::remove(path);
+}
@@ -1,8 +1,14 @@
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <fstream>
+#include <random>
 #include "GlacierFormats.h"
+#include "../src/IntegerRangeCompression.h"
+#include "../src/BinaryWriterMappedFileSink.hpp"
 #include "Texture.h"
 #include "MatiTests.h"
+#include "PrimTests.h"
+#include "ResourceRepositoryTests.h"
 
 using namespace GlacierFormats;
 
@@ -17,6 +23,11 @@ GTEST_TEST(PRIM, PrimSerialization) {
     std::unique_ptr<char[]> data = nullptr;
     auto data_size = prim->serializeToBuffer(data);
     ASSERT_TRUE(data_size);
+    ASSERT_EQ(data_size, prim->serializedSize());
+
+    auto buffer = prim->serializeToBuffer();
+    ASSERT_EQ(buffer.size(), data_size);
+    ASSERT_TRUE(memcmp(buffer.data(), data.get(), data_size) == 0);
 }
 
 GTEST_TEST(BinaryReader, BufferRead)
@@ -44,6 +55,83 @@ GTEST_TEST(BinaryReader, BufferRead)
     ASSERT_THROW(br.read<char>(), InvalidArgumentsException);
 }
 
+GTEST_TEST(BinaryReader, SpanRead)
+{
+    char test_data[] = { 0x01, 0xFF, 0x01, 0x38, 0x31, 0x34, 0x35, 0x54, 0x65, 0x73, 0x74, 0x00 };
+
+    SpanBinaryReader br(BinaryReaderSpanSource(test_data, sizeof(test_data)));
+    ASSERT_TRUE(br.read<char>() == 0x01);
+    ASSERT_TRUE(br.peek<short>() == 0x01FF);
+    ASSERT_TRUE(br.read<short>() == 0x01FF);
+    ASSERT_TRUE(br.read<int>() == 0x35343138);
+    ASSERT_TRUE((br.readCString() == std::string("Test")));
+    ASSERT_TRUE(br.tell() == sizeof(test_data));
+    ASSERT_THROW(br.read<char>(), InvalidArgumentsException);
+}
+
+GTEST_TEST(BinaryReader, CStringView)
+{
+    char test_data[] = { 0x54, 0x65, 0x73, 0x74, 0x00, 0x00, 0x41, 0x42 };
+
+    SpanBinaryReader sbr(BinaryReaderSpanSource(test_data, sizeof(test_data)));
+    std::string scratch;
+    auto view = sbr.readCStringView(scratch);
+    ASSERT_TRUE(view == "Test");
+    ASSERT_TRUE(view.data() == test_data && scratch.empty());//zero-copy
+    ASSERT_TRUE(sbr.readCStringView(scratch).empty());
+    ASSERT_TRUE(sbr.tell() == 6);
+    ASSERT_THROW(sbr.readCString(), InvalidArgumentsException);//unterminated
+
+    BinaryReader br(std::make_unique<LoggedBinaryReaderSource<BinaryReaderBufferSource>>(test_data, sizeof(test_data)));
+    ASSERT_TRUE(br.readCStringView(scratch) == "Test");
+    ASSERT_TRUE(scratch == "Test");
+    ASSERT_TRUE(br.readCString().empty());
+}
+
+GTEST_TEST(BinaryReader, ReadArray)
+{
+    short test_data[] = { 1, 2, 3, 4, 5, 6 };
+
+    SpanBinaryReader sbr(BinaryReaderSpanSource(reinterpret_cast<const char*>(test_data), sizeof(test_data)));
+    std::vector<short> scratch;
+    auto view = sbr.readArray<short>(4, scratch);
+    ASSERT_TRUE(scratch.empty());//zero-copy
+    ASSERT_TRUE(view.size() == 4 && view[0] == 1 && view[3] == 4);
+    ASSERT_TRUE(sbr.tell() == 4 * sizeof(short));
+    ASSERT_THROW(sbr.readArray<short>(3, scratch), InvalidArgumentsException);
+
+    BinaryReader br(std::make_unique<LoggedBinaryReaderSource<BinaryReaderBufferSource>>(reinterpret_cast<const char*>(test_data), sizeof(test_data)));
+    int decoded[6];
+    br.decodeInto<short>(decoded, 6, [](short s) { return 10 * s; });
+    ASSERT_TRUE(decoded[0] == 10 && decoded[5] == 60);
+}
+
+GTEST_TEST(BinaryReader, ReadValidated)
+{
+    short test_data[] = { 1, 2, 3, 4, 5, 6 };
+
+    SpanBinaryReader sbr(BinaryReaderSpanSource(reinterpret_cast<const char*>(test_data), sizeof(test_data)));
+    sbr.seek(sizeof(short));
+    int sum = 0;
+    readValidated(sbr, 3 * sizeof(short), [&sum](auto& vbr) {
+        static_assert(std::is_same_v<std::decay_t<decltype(vbr)>, UncheckedSpanBinaryReader>);
+        for (int i = 0; i < 3; ++i)
+            sum += vbr.template read<short>();
+    });
+    ASSERT_TRUE(sum == 2 + 3 + 4);
+    ASSERT_TRUE(sbr.tell() == 4 * sizeof(short));
+    ASSERT_THROW(readValidated(sbr, 3 * sizeof(short), [](auto&) {}), InvalidArgumentsException);
+    ASSERT_THROW(sbr.validateExtent(-1), InvalidArgumentsException);
+
+    BinaryReader br(reinterpret_cast<const char*>(test_data), sizeof(test_data));
+    readValidated(br, sizeof(test_data), [](auto& vbr) {
+        static_assert(std::is_same_v<std::decay_t<decltype(vbr)>, BinaryReader>);
+        vbr.template read<short>();
+    });
+    ASSERT_TRUE(br.tell() == sizeof(short));
+    ASSERT_THROW(readValidated(br, sizeof(test_data), [](auto&) {}), InvalidArgumentsException);
+}
+
 GTEST_TEST(BinaryReader, BufferSeekTellAlign)
 {
     char buf[] = { 1,2, 0,0, 1,2,3,4, 0,0,0,0 };
@@ -60,6 +148,31 @@ GTEST_TEST(BinaryReader, BufferSeekTellAlign)
     ASSERT_THROW(br.seek(sizeof(buf) + 1), InvalidArgumentsException);
 }
 
+GTEST_TEST(BinaryReader, ReadCoverage)
+{
+    char buf[32]{};
+    BinaryReader br(std::make_unique<CoverageBinaryReaderSource<BinaryReaderBufferSource>>(buf, sizeof(buf)));
+    br.read<int>();
+    br.read<int>();
+    br.seek(4);
+    br.read<short>();
+    br.seek(16);
+    br.read<int64_t>();
+
+    const auto& coverage = static_cast<const CoverageBinaryReaderSource<BinaryReaderBufferSource>*>(br.getSource())->getCoverage();
+    ASSERT_EQ(coverage.coveredSize(), 16);
+    ASSERT_FALSE(coverage.isComplete());
+
+    const auto gaps = coverage.gaps();
+    ASSERT_EQ(gaps.size(), 2);
+    ASSERT_TRUE(gaps[0].begin == 8 && gaps[0].end == 16);
+    ASSERT_TRUE(gaps[1].begin == 24 && gaps[1].end == 32);
+
+    const auto repeated = coverage.repeatedRanges();
+    ASSERT_EQ(repeated.size(), 1);
+    ASSERT_TRUE(repeated[0].begin == 4 && repeated[0].end == 6);
+}
+
 GTEST_TEST(BinaryWriter, BufferWrite) {
     char soll_data[] = {
         0x01, 0xFF, 0x01, 0x38, 0x31, 0x34, 0x35, 0x74, 0x73, 0x65, 0x54, 0x54,
@@ -105,6 +218,499 @@ GTEST_TEST(BinaryWriter, BufferSeekTell) {
     ASSERT_TRUE(memcmp(is_data.data(), soll_data, sizeof(soll_data)) == 0);
 }
 
+//Seeking past the end zero fills the gap.
+GTEST_TEST(BinaryWriter, BufferSeekPastEnd) {
+    char soll_data[] = {
+        0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00
+    };
+
+    BinaryWriter bw;
+    bw.write<char>(0x01);
+    bw.seek(6);
+    ASSERT_TRUE(bw.tell() == 6);
+    bw.write<int>(0x02);
+    auto is_data = bw.release();
+
+    ASSERT_TRUE(is_data.size() == sizeof(soll_data));
+    ASSERT_TRUE(memcmp(is_data.data(), soll_data, sizeof(soll_data)) == 0);
+}
+
+GTEST_TEST(BinaryWriter, BufferGrowth) {
+    //Small writes grow the buffer geometrically, starting from a minimum capacity.
+    BinaryWriter bw;
+    for (int i = 0; i < 0x101; ++i)
+        bw.write<char>(static_cast<char>(i));
+    auto data = bw.release();
+    ASSERT_TRUE(data.size() == 0x101);
+    ASSERT_GE(data.capacity(), 0x200u);
+    ASSERT_LT(data.capacity(), 0x400u);
+    for (int i = 0; i < 0x101; ++i)
+        ASSERT_TRUE(data[i] == static_cast<char>(i));
+
+    //The reserve hint is the initial capacity.
+    BinaryWriter reserved(0x10000);
+    reserved.write<int>(1);
+    ASSERT_GE(reserved.release().capacity(), 0x10000u);
+}
+
+//Released buffers handed back to an arena are reused by later writers, data is handed out without copying.
+GTEST_TEST(BinaryWriter, BufferArena) {
+    BinaryWriterBufferArena arena;
+    ASSERT_TRUE(arena.acquire(0x100).capacity() == 0);
+
+    std::vector<char> small;
+    small.reserve(0x100);
+    std::vector<char> large;
+    large.reserve(0x10000);
+    const auto* large_data = large.data();
+    arena.recycle(std::move(small));
+    arena.recycle(std::move(large));
+
+    BinaryWriter bw(0x1000, &arena);
+    bw.write<int>(0x35343138);
+    auto data = bw.release();
+    ASSERT_TRUE(data.data() == large_data);
+    ASSERT_TRUE(data.size() == sizeof(int));
+    ASSERT_TRUE(data.capacity() >= 0x10000);
+
+    //Without a buffer of sufficient capacity the largest one is handed out.
+    auto fallback = arena.acquire(0x1000);
+    ASSERT_TRUE(fallback.capacity() >= 0x100 && fallback.capacity() < 0x1000);
+    ASSERT_TRUE(arena.acquire(0).capacity() == 0);
+
+    //Recycled buffers are handed out empty.
+    arena.recycle(std::move(data));
+    const auto reused = arena.acquire(0x1000);
+    ASSERT_TRUE(reused.empty());
+    ASSERT_TRUE(reused.data() == large_data);
+}
+
+static std::vector<char> readTestFile(const std::filesystem::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+//Appends, back-patches, gaps and large blocks around the write buffer of a file sink with a buffer capacity of 0x10.
+static void writeFileSinkTestSequence(BinaryWriter& bw) {
+    std::vector<char> block(0x40);
+    for (size_t i = 0; i < block.size(); ++i)
+        block[i] = static_cast<char>(i + 1);
+
+    bw.write<uint64_t>(0);
+    bw.write(block.data(), 0x30);//Written directly
+    bw.seek(4);
+    bw.write<uint32_t>(0xAABBCCDD);//Patch of written data
+    bw.seek(0x38);
+    bw.write<uint32_t>(0x11223344);
+    bw.seek(0x3A);
+    bw.write<uint16_t>(0x5566);//Patch of buffered data
+    bw.seek(0x3C);
+    bw.write(block.data(), 0x40);
+    bw.writeReference(block.data(), 0x20);
+    bw.seek(0xA0);
+    bw.write<uint32_t>(0x01020304);//Gap in front of the buffer
+    bw.seek(0xA8);
+    bw.write<uint32_t>(0x05060708);//Gap inside the buffer
+    bw.seek(0x98);
+    bw.write<uint32_t>(0x090A0B0C);
+    bw.seek(0x9C);
+    bw.write<uint64_t>(0x0D0E0F1011121314);//Patch across the end of the buffer
+    bw.seek(0x98);
+    bw.write(block.data() + 0x20, 0x10);//Block of buffer capacity over buffered data
+    bw.seek(0xAC);
+}
+
+GTEST_TEST(BinaryWriter, FileSinkBackPatching) {
+    const auto path = std::filesystem::temp_directory_path() / "GlacierFormatsTests_FileSink.bin";
+
+    {
+        BinaryWriter bw(std::make_unique<BinaryWriterFileSink>(path, 0x10));
+        bw.write<uint64_t>(1);
+        bw.seek(0);
+        bw.write<uint32_t>(2);
+        //Seeks and back-patches inside the buffer don't touch the file.
+        ASSERT_TRUE(std::filesystem::file_size(path) == 0);
+    }
+    const char soll_data[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    auto is_data = readTestFile(path);
+    ASSERT_TRUE(is_data.size() == sizeof(soll_data));
+    ASSERT_TRUE(memcmp(is_data.data(), soll_data, sizeof(soll_data)) == 0);
+
+    BinaryWriter buffer_bw;
+    writeFileSinkTestSequence(buffer_bw);
+    const auto expected = buffer_bw.release();
+    ASSERT_TRUE(expected.size() == 0xAC);
+
+    {
+        BinaryWriter bw(std::make_unique<BinaryWriterFileSink>(path, 0x10));
+        writeFileSinkTestSequence(bw);
+        ASSERT_TRUE(bw.tell() == 0xAC);
+    }
+    ASSERT_EQ(readTestFile(path), expected);
+    std::filesystem::remove(path);
+}
+
+GTEST_TEST(BinaryWriter, MappedFileSinkBounds) {
+    const auto path = std::filesystem::temp_directory_path() / "GlacierFormatsTests_MappedFileSink.bin";
+
+    {
+        BinaryWriter bw(std::make_unique<BinaryWriterMappedFileSink>(path, 8));
+        bw.write<uint32_t>(0x35343138);
+        bw.write<uint32_t>(0);
+        ASSERT_THROW(bw.write<char>(1), InvalidArgumentsException);
+        bw.seek(6);
+        ASSERT_THROW(bw.write<uint32_t>(1), InvalidArgumentsException);
+        bw.seek(-1);
+        ASSERT_THROW(bw.write<char>(1), InvalidArgumentsException);
+        bw.seek(4);
+        bw.write<uint32_t>(0x01020304);
+        bw.release();
+    }
+
+    const char soll_data[] = { 0x38, 0x31, 0x34, 0x35, 0x04, 0x03, 0x02, 0x01 };
+    auto is_data = readTestFile(path);
+    ASSERT_TRUE(is_data.size() == sizeof(soll_data));
+    ASSERT_TRUE(memcmp(is_data.data(), soll_data, sizeof(soll_data)) == 0);
+    std::filesystem::remove(path);
+}
+
+//Chunk of owned data, a reference, patches and gaps in the following chunk, a second reference and a trailing chunk.
+static void writeSegmentSinkTestSequence(BinaryWriter& bw, const std::shared_ptr<std::vector<char>>& block) {
+    bw.write<uint64_t>(0);
+    bw.writeReference(block->data(), 0x100);//Small references are copied
+    bw.writeReference(block->data(), 0x2000, block);
+    bw.write<uint32_t>(0x01020304);
+    bw.seek(0x2110);
+    bw.write<uint32_t>(0x05060708);//Gap
+    bw.seek(4);
+    bw.write<uint32_t>(0xAABBCCDD);//Patch of the first chunk
+    bw.seek(0x106);
+    bw.write<uint16_t>(0x1122);//Patch up to the reference
+    bw.seek(0x2112);
+    bw.write<uint32_t>(0x33445566);//Patch across the end of the second chunk
+    bw.writeReference(block->data() + 0x1000, 0x1000, block);
+    bw.write<uint16_t>(0x7788);
+}
+
+GTEST_TEST(BinaryWriter, SegmentSink) {
+    auto block = std::make_shared<std::vector<char>>(0x2000);
+    for (size_t i = 0; i < block->size(); ++i)
+        (*block)[i] = static_cast<char>(i * 7);
+
+    BinaryWriter buffer_bw;
+    writeSegmentSinkTestSequence(buffer_bw, block);
+    const auto expected = buffer_bw.release();
+    ASSERT_TRUE(expected.size() == 0x3118);
+
+    BinaryWriter bw(std::make_unique<BinaryWriterSegmentSink>());
+    writeSegmentSinkTestSequence(bw, block);
+    ASSERT_EQ(bw.release(), expected);
+
+    writeSegmentSinkTestSequence(bw, block);
+    const auto segments = bw.releaseSegments();
+    ASSERT_EQ(segments.size(), 5u);
+    std::vector<char> concatenated;
+    for (const auto& segment : segments) {
+        ASSERT_TRUE(segment.owner);
+        concatenated.insert(concatenated.end(), segment.data, segment.data + segment.size);
+    }
+    ASSERT_EQ(concatenated, expected);
+    //References aren't copied.
+    ASSERT_TRUE(segments[1].data == block->data() && segments[1].size == 0x2000);
+    ASSERT_TRUE(segments[3].data == block->data() + 0x1000 && segments[3].size == 0x1000);
+
+    //Referenced data can't be patched.
+    BinaryWriter patch_bw(std::make_unique<BinaryWriterSegmentSink>());
+    patch_bw.write<uint32_t>(0);
+    patch_bw.writeReference(block->data(), block->size(), block);
+    patch_bw.seek(2);
+    ASSERT_THROW(patch_bw.write<uint32_t>(0), InvalidArgumentsException);
+    patch_bw.seek(0x100);
+    ASSERT_THROW(patch_bw.write<char>(0), InvalidArgumentsException);
+}
+
+GTEST_TEST(RPKG, WriteRoundTrip) {
+    const auto path = std::filesystem::temp_directory_path() / "GlacierFormatsTests_WriteRoundTrip.rpkg";
+    const std::vector<ResourceReference> references;
+
+    //Small runtime ids, RPKG guesses patch archives from the upper bytes of the data following the header.
+    std::vector<std::vector<char>> data(3);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i].resize(0x100 * (i + 1) + 3);
+        for (size_t j = 0; j < data[i].size(); ++j)
+            data[i][j] = static_cast<char>(i * 0x11 + j);
+    }
+
+    {
+        RPKG rpkg;
+        rpkg.deletion_list.push_back(0x0012345600000010);
+        for (size_t i = 0; i < data.size(); ++i)
+            rpkg.insertFile(0x0012345600000001 + i, "TEST", data[i], &references);
+        //An empty payload of a new patch has no source archive to read from.
+        rpkg.insertFile(0x0012345600000001 + data.size(), "TEST", std::vector<BinaryWriterSegment>(), &references);
+        rpkg.write(path);
+    }
+
+    {
+        RPKG rpkg(path);
+        ASSERT_TRUE(rpkg.archive_type == RPKG_TYPE::PATCH);
+        ASSERT_EQ(rpkg.deletion_list.size(), 1u);
+        ASSERT_EQ(rpkg.files.size(), data.size() + 1);
+        ASSERT_EQ(rpkg.getFileByRuntimeId(0x0012345600000001 + data.size())->entry_descriptor.size, 0u);
+        for (size_t i = 0; i < data.size(); ++i) {
+            char* file_data = nullptr;
+            const auto size = rpkg.getFileData(0x0012345600000001 + i, &file_data);
+            std::unique_ptr<char[]> owner(file_data);
+            ASSERT_EQ(std::vector<char>(file_data, file_data + size), data[i]);
+            ASSERT_EQ(rpkg.getFileByRuntimeId(0x0012345600000001 + i)->entry_descriptor.type, "TEST");
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+//Runs fn once for every SimdLevel supported by the CPU and restores the default level afterwards.
+template<typename Fn>
+void forEachSimdLevel(Fn&& fn) {
+    for (auto level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (static_cast<int>(level) > static_cast<int>(supportedSimdLevel()))
+            continue;
+        setSimdLevel(level);
+        fn();
+    }
+    setSimdLevel(supportedSimdLevel());
+}
+
+GTEST_TEST(VertexCodec, DecodePositions) {
+    std::mt19937 rng(0x504F53);
+    std::uniform_int_distribution<int> short_dist(std::numeric_limits<short>::min(), std::numeric_limits<short>::max());
+    std::uniform_real_distribution<float> float_dist(-100.0f, 100.0f);
+
+    for (size_t count : { 0, 1, 2, 3, 5, 8, 13, 1001 }) {
+        std::vector<int16_t> packed(4 * count);
+        for (auto& v : packed)
+            v = short_dist(rng);
+        float scale[4];
+        float bias[4];
+        for (int i = 0; i < 4; ++i) {
+            scale[i] = float_dist(rng);
+            bias[i] = float_dist(rng);
+        }
+
+        std::vector<float> expected(4 * count);
+        for (size_t i = 0; i < expected.size(); ++i)
+            expected[i] = IntegerRangeCompressor<short, float>::decompress(packed[i], scale[i % 4], bias[i % 4]);
+
+        forEachSimdLevel([&]() {
+            std::vector<float> decoded(4 * count);
+            VertexCodec::decodePositions(packed.data(), decoded.data(), count, scale, bias);
+            ASSERT_TRUE(std::memcmp(decoded.data(), expected.data(), expected.size() * sizeof(float)) == 0);
+        });
+    }
+}
+
+GTEST_TEST(VertexCodec, DecodeVertexData) {
+    std::mt19937 rng(0x564454);
+    std::uniform_int_distribution<int> byte_dist(0, 0xFF);
+    const float uv_scale[2] = { 1.5f, -0.75f };
+    const float uv_bias[2] = { 0.25f, 3.0f };
+
+    for (size_t count : { 0, 1, 3, 1001 }) {
+        std::vector<uint8_t> records(VertexCodec::vertex_data_record_size * count);
+        for (auto& byte : records)
+            byte = static_cast<uint8_t>(byte_dist(rng));
+
+        for (bool flip_v : { false, true }) {
+            std::vector<float> expected_frames(12 * count);
+            std::vector<float> expected_uvs(2 * count);
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t* record = &records[VertexCodec::vertex_data_record_size * i];
+                for (int j = 0; j < 12; ++j)
+                    expected_frames[12 * i + j] = VertexCodec::decompress8BitFloat(record[j]);
+                int16_t uv[2];
+                std::memcpy(uv, record + 12, sizeof(uv));
+                expected_uvs[2 * i + 0] = IntegerRangeCompressor<short, float>::decompress(uv[0], uv_scale[0], uv_bias[0]);
+                expected_uvs[2 * i + 1] = IntegerRangeCompressor<short, float>::decompress(uv[1], uv_scale[1], uv_bias[1]) * (flip_v ? -1.0f : 1.0f);
+            }
+
+            forEachSimdLevel([&]() {
+                std::vector<float> normals(4 * count), tangents(4 * count), bitangents(4 * count), uvs(2 * count);
+                VertexCodec::decodeVertexData(records.data(), count, normals.data(), tangents.data(), bitangents.data(), uvs.data(), uv_scale, uv_bias, flip_v);
+                for (size_t i = 0; i < count; ++i) {
+                    ASSERT_TRUE(std::memcmp(&normals[4 * i], &expected_frames[12 * i + 0], 4 * sizeof(float)) == 0);
+                    ASSERT_TRUE(std::memcmp(&tangents[4 * i], &expected_frames[12 * i + 4], 4 * sizeof(float)) == 0);
+                    ASSERT_TRUE(std::memcmp(&bitangents[4 * i], &expected_frames[12 * i + 8], 4 * sizeof(float)) == 0);
+                }
+                ASSERT_TRUE(std::memcmp(uvs.data(), expected_uvs.data(), uvs.size() * sizeof(float)) == 0);
+            });
+        }
+    }
+}
+
+GTEST_TEST(VertexCodec, EncodeRoundTrip) {
+    std::mt19937 rng(0x454E43);
+    std::uniform_real_distribution<float> unit_dist(-1.0f, 1.0f);
+    const float scale[4] = { 2.0f, 32767.0f, 0.5f, 1.0f };
+    const float bias[4] = { -1.0f, 0.0f, 0.25f, 0.0f };
+    const float uv_scale[2] = { 1.5f, 0.75f };
+    const float uv_bias[2] = { 0.5f, -0.25f };
+
+    for (size_t count : { 0, 1, 2, 3, 1001 }) {
+        std::vector<float> positions(4 * count), normals(4 * count), tangents(4 * count), bitangents(4 * count), uvs(2 * count);
+        for (size_t i = 0; i < 4 * count; ++i) {
+            positions[i] = bias[i % 4] + scale[i % 4] * unit_dist(rng);
+            normals[i] = unit_dist(rng);
+            tangents[i] = unit_dist(rng);
+            bitangents[i] = unit_dist(rng);
+        }
+        //Exact halfway cases for the position rounding.
+        for (size_t i = 0; i < count; ++i)
+            positions[4 * i + 1] = static_cast<float>(static_cast<int>(i % 0x8000)) + 0.5f;
+        for (size_t i = 0; i < 2 * count; ++i)
+            uvs[i] = uv_bias[i % 2] + uv_scale[i % 2] * unit_dist(rng);
+
+        std::vector<int16_t> expected_positions(4 * count);
+        std::vector<uint8_t> expected_records(VertexCodec::vertex_data_record_size * count);
+        for (size_t i = 0; i < count; ++i) {
+            for (int j = 0; j < 3; ++j)
+                expected_positions[4 * i + j] = IntegerRangeCompressor<short, float>::compress(positions[4 * i + j], scale[j], bias[j]);
+            expected_positions[4 * i + 3] = 0x7FFF;
+
+            uint8_t* record = &expected_records[VertexCodec::vertex_data_record_size * i];
+            for (int j = 0; j < 4; ++j) {
+                record[j] = VertexCodec::compress8BitFloat(normals[4 * i + j]);
+                record[4 + j] = VertexCodec::compress8BitFloat(tangents[4 * i + j]);
+                record[8 + j] = VertexCodec::compress8BitFloat(j < 3 ? bitangents[4 * i + j] : 0.0f);
+            }
+            const int16_t uv[2] = {
+                IntegerRangeCompressor<short, float>::compress(uvs[2 * i + 0], uv_scale[0], uv_bias[0]),
+                IntegerRangeCompressor<short, float>::compress(uvs[2 * i + 1], uv_scale[1], uv_bias[1])
+            };
+            std::memcpy(record + 12, uv, sizeof(uv));
+        }
+
+        forEachSimdLevel([&]() {
+            std::vector<int16_t> packed_positions(4 * count);
+            VertexCodec::encodePositions(positions.data(), packed_positions.data(), count, scale, bias);
+            ASSERT_TRUE(packed_positions == expected_positions);
+
+            std::vector<uint8_t> records(VertexCodec::vertex_data_record_size * count);
+            VertexCodec::encodeVertexData(normals.data(), tangents.data(), bitangents.data(), uvs.data(), count, records.data(), uv_scale, uv_bias);
+            ASSERT_TRUE(records == expected_records);
+        });
+    }
+}
+
+#pragma pack(push, 1)
+struct LayoutTestPacked {
+    uint16_t a;
+    uint8_t b;
+    uint32_t c[2];
+};
+#pragma pack(pop)
+
+struct LayoutTestRecord {
+    uint32_t id;
+    uint32_t size;
+    bool flag;
+
+    struct PackedFlags {
+        using Packed = uint16_t;
+        static void decode(LayoutTestRecord& record, const uint16_t& flags) { record.flag = flags & 1; }
+        static uint16_t encode(const LayoutTestRecord& record) { return record.flag ? 1 : 0; }
+    };
+};
+
+GTEST_TEST(BinaryLayout, ReadWrite) {
+    using PackedLayout = BinaryLayout<LayoutTestPacked, Field<&LayoutTestPacked::a>, Field<&LayoutTestPacked::b>, Field<&LayoutTestPacked::c>>;
+    using SwappedLayout = BinaryLayout<LayoutTestPacked, Field<&LayoutTestPacked::b>, Field<&LayoutTestPacked::a>, Field<&LayoutTestPacked::c>>;
+    using RecordLayout = BinaryLayout<LayoutTestRecord,
+        Field<&LayoutTestRecord::size>,
+        EncodedField<LayoutTestRecord, LayoutTestRecord::PackedFlags>,
+        Field<&LayoutTestRecord::id>>;
+
+    static_assert(PackedLayout::is_memory_layout && PackedLayout::size == 11);
+    static_assert(!RecordLayout::is_memory_layout && RecordLayout::size == 10);
+    ASSERT_TRUE(PackedLayout::matchesMemoryLayout());
+    ASSERT_FALSE(SwappedLayout::matchesMemoryLayout());
+
+    BinaryWriter bw;
+    RecordLayout::write(bw, LayoutTestRecord{ 7, 0x100, true });
+    PackedLayout::write(bw, LayoutTestPacked{ 1, 2, { 3, 4 } });
+    auto data = bw.release();
+    ASSERT_TRUE(data.size() == RecordLayout::size + PackedLayout::size);
+
+    const char soll_data[] = { 0x00, 0x01, 0x00, 0x00, 0x01, 0x00, 0x07, 0x00, 0x00, 0x00 };
+    ASSERT_TRUE(memcmp(data.data(), soll_data, sizeof(soll_data)) == 0);
+
+    BinaryReader br(data.data(), data.size());
+    const auto record = RecordLayout::read(br);
+    ASSERT_TRUE(record.id == 7 && record.size == 0x100 && record.flag);
+    const auto packed = PackedLayout::read(br);
+    ASSERT_TRUE(packed.a == 1 && packed.b == 2 && packed.c[0] == 3 && packed.c[1] == 4);
+    ASSERT_THROW(RecordLayout::read(br), InvalidArgumentsException);
+}
+
+struct LayoutTestValidated {
+    uint32_t count;
+    uint32_t capacity;
+
+    void Assert() {
+        GLACIER_ASSERT_TRUE(count <= capacity);
+    }
+};
+
+//Layouts that list their fields out of member order serialize in declaration order, layouts with an Assert() member 
+//validate every object they read.
+GTEST_TEST(BinaryLayout, FieldOrderAndValidation) {
+    using SwappedLayout = BinaryLayout<LayoutTestPacked, Field<&LayoutTestPacked::b>, Field<&LayoutTestPacked::a>, Field<&LayoutTestPacked::c>>;
+    using ValidatedLayout = BinaryLayout<LayoutTestValidated, Field<&LayoutTestValidated::count>, Field<&LayoutTestValidated::capacity>>;
+
+    static_assert(SwappedLayout::is_memory_layout);
+    ASSERT_FALSE(SwappedLayout::usesMemoryLayout());
+    ASSERT_TRUE(TextureHeaderLayout::usesMemoryLayout());
+
+    BinaryWriter bw;
+    SwappedLayout::write(bw, LayoutTestPacked{ 1, 2, { 3, 4 } });
+    ValidatedLayout::write(bw, LayoutTestValidated{ 1, 2 });
+    ValidatedLayout::write(bw, LayoutTestValidated{ 3, 2 });
+    auto data = bw.release();
+    ASSERT_TRUE(data.size() == SwappedLayout::size + 2 * ValidatedLayout::size);
+
+    const char soll_data[] = { 0x02, 0x01, 0x00, 0x03, 0x00 };
+    ASSERT_TRUE(memcmp(data.data(), soll_data, sizeof(soll_data)) == 0);
+
+    BinaryReader br(data.data(), data.size());
+    const auto packed = SwappedLayout::read(br);
+    ASSERT_TRUE(packed.a == 1 && packed.b == 2 && packed.c[0] == 3 && packed.c[1] == 4);
+    ASSERT_TRUE(ValidatedLayout::read(br).count == 1);
+    ASSERT_THROW(ValidatedLayout::read(br), AssertionException);
+}
+
+GTEST_TEST(ThreadPool, NestedParallelFor) {
+    ThreadPool pool(4);
+    std::atomic<size_t> calls = 0;
+    pool.parallelFor(64, [&](size_t) {
+        pool.parallelFor(16, [&](size_t) { ++calls; });
+    });
+    ASSERT_EQ(calls.load(), 64u * 16u);
+}
+
+//A throwing call doesn't cancel the other calls, the exception is rethrown once all of them returned.
+GTEST_TEST(ThreadPool, ParallelForExceptionIsolation) {
+    ThreadPool pool(4);
+    std::atomic<size_t> calls = 0;
+    ASSERT_THROW(pool.parallelFor(100, [&](size_t i) {
+        ++calls;
+        if (i % 10 == 3)
+            throw std::runtime_error("parallelFor test");
+    }), std::runtime_error);
+    ASSERT_EQ(calls.load(), 100u);
+
+    //The pool stays usable.
+    calls = 0;
+    pool.parallelFor(100, [&](size_t) { ++calls; });
+    ASSERT_EQ(calls.load(), 100u);
+}
 
 int main(int argc, char** argv)
 {